@@ -37,4 +37,55 @@ operator<<(std::ostream& out, SearchState state)
 
 //------------------------------------------------------------------------------
 
+constexpr double LocateStrategy::DEFAULT_STEP_COST;
+constexpr double LocateStrategy::DEFAULT_RANGE_STEP_COST;
+constexpr double LocateStrategy::DEFAULT_RANGE_OVERHEAD;
+constexpr double LocateStrategy::DEFAULT_RUN_COST;
+const size_type  LocateStrategy::DEFAULT_CHUNK_SIZE;
+const size_type LocateStrategy::CALIBRATION_QUERIES;
+const size_type LocateStrategy::CALIBRATION_RANGE;
+const size_type LocateStrategy::CALIBRATION_ROUNDS;
+
+LocateStrategy::LocateStrategy()
+{
+  this->reset();
+}
+
+void
+LocateStrategy::reset()
+{
+  this->step_cost = DEFAULT_STEP_COST;
+  this->range_step_cost = DEFAULT_RANGE_STEP_COST;
+  this->range_overhead = DEFAULT_RANGE_OVERHEAD;
+  this->run_cost = DEFAULT_RUN_COST;
+  this->chunk_size = DEFAULT_CHUNK_SIZE;
+}
+
+std::string
+LocateStrategy::name(strategy_type strategy)
+{
+  switch(strategy)
+  {
+  case AUTOMATIC:
+    return "automatic";
+  case POINTWISE:
+    return "pointwise";
+  case RANGE:
+    return "range";
+  case CHUNKED:
+    return "chunked";
+  }
+  return "unknown";
+}
+
+void
+LocateStrategy::print(std::ostream& out) const
+{
+  out << "Locate costs (ns): step " << this->step_cost << ", range step " << this->range_step_cost
+      << ", range overhead " << this->range_overhead << ", run " << this->run_cost
+      << "; chunk size " << this->chunk_size << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
 } // namespace gbwt
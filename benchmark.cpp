@@ -25,7 +25,10 @@
 #include <random>
 #include <unistd.h>
 
+#include <gbwt/cached_gbwt.h>
 #include <gbwt/dynamic_gbwt.h>
+#include <gbwt/fast_locate.h>
+#include <gbwt/internal.h>
 
 using namespace gbwt;
 
@@ -44,30 +47,95 @@ std::vector<SearchState> findBenchmark(const GBWT& compressed_index, const Dynam
 size_type totalLength(const std::vector<SearchState>& states);
 
 template<class GBWTType>
-void locateBenchmark(const GBWTType& index, const std::vector<SearchState>& queries);
+void locateBenchmark(const GBWTType& index, const std::vector<SearchState>& queries, const LocateStrategy& costs);
+
+void fastLocateBenchmark(const FastLocate& r_index, const std::string& query_base);
 
 void extractBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index);
 
+void decodeBenchmark(const GBWT& compressed_index);
+
 //------------------------------------------------------------------------------
 
 int
 main(int argc, char** argv)
 {
   if(argc < 2) { printUsage(); }
-  std::string index_base = argv[1], query_base;
-  if(argc > 2) { query_base = argv[2]; }
+
+  bool calibrate = false, decode = false, dense_directory = false, r_index = false, unary_chains = false;
+  size_type prefix_length = 0;
+  int threads = omp_get_max_threads();
+  int c = 0;
+  while((c = getopt(argc, argv, "cDdp:Rt:u")) != -1)
+  {
+    switch(c)
+    {
+    case 'c':
+      calibrate = true; break;
+    case 'D':
+      decode = true; break;
+    case 'd':
+      dense_directory = true; break;
+    case 'p':
+      prefix_length = std::stoul(optarg); break;
+    case 'R':
+      r_index = true; break;
+    case 't':
+      threads = std::max(1, std::stoi(optarg)); break;
+    case 'u':
+      unary_chains = true; break;
+    case '?':
+      std::exit(EXIT_FAILURE);
+    default:
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if(optind >= argc) { printUsage(EXIT_FAILURE); }
+  std::string index_base = argv[optind], query_base;
+  if(argc > optind + 1) { query_base = argv[optind + 1]; }
 
   Version::print(std::cout, tool_name);
 
   printHeader("Index name"); std::cout << index_base << std::endl;
   if(!(query_base.empty())) { printHeader("Query name"); std::cout << query_base << std::endl; }
+  printHeader("Directory"); std::cout << (dense_directory ? "dense" : "select") << std::endl;
+  if(unary_chains) { printHeader("Unary chains"); std::cout << "enabled" << std::endl; }
+  if(prefix_length > 0) { printHeader("Prefix table"); std::cout << "length " << prefix_length << std::endl; }
+  if(r_index) { printHeader("r-index"); std::cout << "enabled" << std::endl; }
+  if(decode) { printHeader("Run decoding"); std::cout << "enabled" << std::endl; }
+  printHeader("Threads"); std::cout << threads << std::endl;
   std::cout << std::endl;
 
+  omp_set_num_threads(threads);
+
   double start = readTimer();
 
   GBWT compressed_index;
+  if(dense_directory) { compressed_index.bwt.setDirectory(RecordArray::DIRECTORY_DENSE); }
   sdsl::load_from_file(compressed_index, index_base + GBWT::EXTENSION);
+  if(unary_chains) { compressed_index.setUnaryChains(true); }
+  if(prefix_length > 0)
+  {
+    std::string prefix_name = index_base + PrefixTable::EXTENSION;
+    if(!(compressed_index.loadPrefixTable(prefix_name) && compressed_index.prefix_table.length() == prefix_length))
+    {
+      std::cerr << "benchmark: Building a prefix table of length " << prefix_length << std::endl;
+      compressed_index.setPrefixTable(prefix_length);
+    }
+  }
   printStatistics(compressed_index, index_base);
+  LocateStrategy costs;
+  if(calibrate)
+  {
+    double calibration_start = readTimer();
+    costs.calibrate(compressed_index);
+    double seconds = readTimer() - calibration_start;
+    std::cout << "Calibrated the locate() cost model in " << seconds << " seconds" << std::endl;
+    costs.print(std::cout);
+    std::cout << std::endl;
+  }
+  if(decode) { decodeBenchmark(compressed_index); }
   if(query_base.empty()) { return 0; }
 
   DynamicGBWT dynamic_index;
@@ -76,8 +144,18 @@ main(int argc, char** argv)
 
   std::vector<SearchState> results = findBenchmark(compressed_index, dynamic_index, query_base);
 
-  locateBenchmark(compressed_index, results);
-  locateBenchmark(dynamic_index, results);
+  locateBenchmark(compressed_index, results, costs);
+  locateBenchmark(dynamic_index, results, costs);
+  if(r_index)
+  {
+    FastLocate fast_locate;
+    if(!(sdsl::load_from_file(fast_locate, index_base + FastLocate::EXTENSION) && fast_locate.setGBWT(compressed_index)))
+    {
+      std::cerr << "benchmark: Building the r-index" << std::endl;
+      FastLocate(compressed_index).swap(fast_locate);
+    }
+    fastLocateBenchmark(fast_locate, query_base);
+  }
 
   extractBenchmark(compressed_index, dynamic_index);
 
@@ -95,7 +173,14 @@ printUsage(int exit_code)
 {
   Version::print(std::cerr, tool_name);
 
-  std::cerr << "Usage: benchmark index_base [query_base]" << std::endl;
+  std::cerr << "Usage: benchmark [options] index_base [query_base]" << std::endl;
+  std::cerr << "  -c    Calibrate the locate() cost model before the benchmarks" << std::endl;
+  std::cerr << "  -D    Benchmark run decoding with division and reciprocal multiplication" << std::endl;
+  std::cerr << "  -d    Use the dense record directory in the compressed index" << std::endl;
+  std::cerr << "  -p N  Use a prefix table of length N (from index_base.prefix or built in memory)" << std::endl;
+  std::cerr << "  -R    Benchmark r-index locate() (from index_base.ri or built in memory)" << std::endl;
+  std::cerr << "  -t N  Use N threads in the parallel batch queries" << std::endl;
+  std::cerr << "  -u    Use unary chains in the compressed index" << std::endl;
   std::cerr << std::endl;
 
   std::exit(exit_code);
@@ -149,6 +234,13 @@ generateQueries(const std::string& base_name)
 
 std::string indexType(const GBWT&) { return "Compressed GBWT"; }
 std::string indexType(const DynamicGBWT&) { return "Dynamic GBWT"; }
+std::string indexType(const CachedGBWT&) { return "Cached GBWT"; }
+
+void
+printCacheStatistics(const CachedGBWT& index)
+{
+  printHeader("Cache hit rate"); std::cout << index.hits() << " / " << (index.hits() + index.misses()) << " (" << (100.0 * index.hitRate()) << "%)" << std::endl;
+}
 
 size_type
 totalLength(const std::vector<SearchState>& states)
@@ -176,6 +268,67 @@ findBenchmark(const GBWTType& index, const std::vector<std::vector<node_type>>&
   return total_length;
 }    
 
+template<class GBWTType>
+size_type
+batchFindBenchmark(const GBWTType& index, const std::vector<std::vector<node_type>>& queries)
+{
+  double start = readTimer();
+  std::vector<SearchState> results = index.find(queries);
+  size_type total_length = 0;
+  for(SearchState state : results) { total_length += Range::length(state.range); }
+  double seconds = readTimer() - start;
+  printTime("Batch", queries.size(), seconds);
+  return total_length;
+}
+
+template<class GBWTType>
+size_type
+sharedFindBenchmark(const GBWTType& index, const std::vector<std::vector<node_type>>& queries)
+{
+  double start = readTimer();
+  std::vector<SearchState> results = index.findShared(queries);
+  size_type total_length = 0;
+  for(SearchState state : results) { total_length += Range::length(state.range); }
+  double seconds = readTimer() - start;
+  printTime("Shared", queries.size(), seconds);
+  return total_length;
+}
+
+// Run the queries twice through a result cache.
+size_type
+resultCacheBenchmark(const GBWT& index, const std::vector<std::vector<node_type>>& queries)
+{
+  ResultCache cache(index);
+  double start = readTimer();
+  size_type total_length = 0;
+  for(size_type pass = 0; pass < 2; pass++)
+  {
+    for(const std::vector<node_type>& query : queries)
+    {
+      SearchState state = cache.find(query);
+      if(pass == 0) { total_length += Range::length(state.range); }
+    }
+  }
+  double seconds = readTimer() - start;
+  printTime("Result cache", 2 * queries.size(), seconds);
+  printHeader("Cache hit rate"); std::cout << cache.hits() << " / " << (cache.hits() + cache.misses()) << " (" << (100.0 * cache.hitRate()) << "%)" << std::endl;
+  return total_length;
+}
+
+template<class GBWTType>
+size_type
+parallelFindBenchmark(const GBWTType& index, const std::vector<std::vector<node_type>>& queries)
+{
+  double start = readTimer();
+  std::vector<SearchState> results;
+  index.findAll(queries, results);
+  size_type total_length = 0;
+  for(SearchState state : results) { total_length += Range::length(state.range); }
+  double seconds = readTimer() - start;
+  printTime("Parallel", queries.size(), seconds);
+  return total_length;
+}
+
 std::vector<SearchState>
 findBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, const std::string& base_name)
 {
@@ -186,6 +339,13 @@ findBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, co
 
   size_type compressed_length = findBenchmark(compressed_index, queries, results);
   size_type dynamic_length = findBenchmark(dynamic_index, queries, results);
+  CachedGBWT cached_index(compressed_index);
+  size_type cached_length = findBenchmark(cached_index, queries, results);
+  printCacheStatistics(cached_index);
+  size_type batch_length = batchFindBenchmark(compressed_index, queries);
+  size_type parallel_length = parallelFindBenchmark(compressed_index, queries);
+  size_type shared_length = sharedFindBenchmark(compressed_index, queries);
+  size_type result_length = resultCacheBenchmark(compressed_index, queries);
 
   if(compressed_length != dynamic_length)
   {
@@ -193,6 +353,31 @@ findBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, co
               << compressed_length << " (" << indexType(compressed_index) << "), "
               << dynamic_length << " (" << indexType(dynamic_index) << ")" << std::endl;
   }
+  if(batch_length != compressed_length)
+  {
+    std::cerr << "findBenchmark(): Batch length mismatch: "
+              << batch_length << " (batch), " << compressed_length << " (single)" << std::endl;
+  }
+  if(parallel_length != compressed_length)
+  {
+    std::cerr << "findBenchmark(): Parallel length mismatch: "
+              << parallel_length << " (parallel), " << compressed_length << " (single)" << std::endl;
+  }
+  if(cached_length != compressed_length)
+  {
+    std::cerr << "findBenchmark(): Cached length mismatch: "
+              << cached_length << " (cached), " << compressed_length << " (single)" << std::endl;
+  }
+  if(result_length != compressed_length)
+  {
+    std::cerr << "findBenchmark(): Result cache length mismatch: "
+              << result_length << " (result cache), " << compressed_length << " (single)" << std::endl;
+  }
+  if(shared_length != compressed_length)
+  {
+    std::cerr << "findBenchmark(): Shared length mismatch: "
+              << shared_length << " (shared), " << compressed_length << " (single)" << std::endl;
+  }
 
   std::cout << results.size() << " ranges of total length " << compressed_length << std::endl;
   std::cout << std::endl;
@@ -204,7 +389,7 @@ findBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, co
 
 template<class GBWTType>
 void
-locateBenchmark(const GBWTType& index, const std::vector<SearchState>& queries)
+locateBenchmark(const GBWTType& index, const std::vector<SearchState>& queries, const LocateStrategy& costs)
 {
   std::cout << "locate() benchmarks (" << indexType(index) << "):" << std::endl;
 
@@ -238,6 +423,77 @@ locateBenchmark(const GBWTType& index, const std::vector<SearchState>& queries)
     printTime("Fast", found, seconds);
   }
 
+  {
+    double start = readTimer();
+    size_type found = 0;
+    QueryContext context;
+    std::vector<size_type> result;
+    for(SearchState query : queries)
+    {
+      index.locate(query, result, context, costs);
+      found += result.size();
+    }
+    double seconds = readTimer() - start;
+    printTime("Context", found, seconds);
+  }
+
+  {
+    double start = readTimer();
+    size_type found = 0;
+    QueryContext context;
+    std::vector<size_type> result;
+    for(SearchState query : queries)
+    {
+      index.locate(query, result, context, LocateStrategy::RANGE);
+      found += result.size();
+    }
+    double seconds = readTimer() - start;
+    printTime("Range", found, seconds);
+  }
+
+  {
+    double start = readTimer();
+    std::vector<std::vector<size_type>> results;
+    index.locateAll(queries, results);
+    size_type found = 0;
+    for(const std::vector<size_type>& result : results) { found += result.size(); }
+    double seconds = readTimer() - start;
+    printTime("Parallel", found, seconds);
+  }
+
+  std::cout << std::endl;
+}
+
+void
+fastLocateBenchmark(const FastLocate& r_index, const std::string& query_base)
+{
+  std::cout << "locate() benchmarks (r-index):" << std::endl;
+  printHeader("Runs"); std::cout << r_index.runs() << std::endl;
+  printHeader("phi() keys"); std::cout << r_index.keys() << std::endl;
+  printHeader("Size"); std::cout << inMegabytes(sdsl::size_in_bytes(r_index)) << " MB" << std::endl;
+
+  // locate() needs the text positions from FastLocate::find().
+  std::vector<std::vector<node_type>> patterns = generateQueries(query_base);
+  std::vector<SearchState> queries(patterns.size());
+  std::vector<size_type> first(patterns.size(), invalid_offset());
+  for(size_type i = 0; i < patterns.size(); i++)
+  {
+    queries[i] = r_index.find(patterns[i].begin(), patterns[i].end(), first[i]);
+  }
+
+  {
+    double start = readTimer();
+    size_type found = 0;
+    std::vector<size_type> result;
+    for(size_type i = 0; i < queries.size(); i++)
+    {
+      r_index.locate(queries[i], result, first[i]);
+      found += result.size();
+    }
+    double seconds = readTimer() - start;
+    printTime("r-index", found, seconds);
+  }
+
   std::cout << std::endl;
 }
 
@@ -268,6 +524,134 @@ extractBenchmark(const GBWT& compressed_index, const DynamicGBWT& dynamic_index)
   std::cout << "extract() benchmarks:" << std::endl;
   extractBenchmark(compressed_index);
   extractBenchmark(dynamic_index);
+  {
+    CachedGBWT cached_index(compressed_index);
+    extractBenchmark(cached_index);
+    printCacheStatistics(cached_index);
+  }
+
+  {
+    double start = readTimer();
+    size_type total_length = 0;
+    std::vector<node_type> sequence;
+    for(size_type i = 0; i < compressed_index.sequences(); i++)
+    {
+      compressed_index.extract(i, sequence);
+      total_length += sequence.size() + 1;
+    }
+    double seconds = readTimer() - start;
+    printTime("Buffer", compressed_index.sequences(), seconds);
+    if(total_length != compressed_index.size())
+    {
+      std::cerr << "extractBenchmark(): Buffer: Total length " << total_length << ", expected " << compressed_index.size() << std::endl;
+    }
+  }
+
+  {
+    double start = readTimer();
+    std::vector<size_type> sequences(compressed_index.sequences());
+    for(size_type i = 0; i < sequences.size(); i++) { sequences[i] = i; }
+    std::vector<std::vector<node_type>> results;
+    compressed_index.extractAll(sequences, results);
+    size_type total_length = 0;
+    for(const std::vector<node_type>& sequence : results) { total_length += sequence.size() + 1; }
+    double seconds = readTimer() - start;
+    printTime("Parallel", sequences.size(), seconds);
+    if(total_length != compressed_index.size())
+    {
+      std::cerr << "extractBenchmark(): Parallel: Total length " << total_length << ", expected " << compressed_index.size() << std::endl;
+    }
+  }
+  std::cout << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Decodes all runs in the compressed index using the division-based decoder from earlier
+  versions and the current Run decoder.
+*/
+
+struct DivisionDecoder
+{
+  size_type sigma, run_continues;
+
+  explicit DivisionDecoder(size_type alphabet_size) : sigma(alphabet_size), run_continues(0)
+  {
+    if(this->sigma < 255) { this->run_continues = 256 / this->sigma; }
+  }
+
+  run_type read(const byte_type* array, size_type& i) const
+  {
+    run_type run;
+    if(this->run_continues == 0)
+    {
+      run.first = ByteCode::read(array, i);
+      run.second = ByteCode::read(array, i) + 1;
+    }
+    else
+    {
+      run = run_type(array[i] % this->sigma, array[i] / this->sigma + 1); i++;
+      if(run.second >= this->run_continues) { run.second += ByteCode::read(array, i); }
+    }
+    return run;
+  }
+};
+
+template<class Decoder>
+size_type
+decodeRecords(const std::vector<CompressedRecord>& records, size_type& checksum)
+{
+  size_type runs = 0;
+  for(const CompressedRecord& record : records)
+  {
+    Decoder decoder(record.outdegree());
+    for(size_type i = 0; i < record.data_size; runs++)
+    {
+      run_type run = decoder.read(record.body, i);
+      checksum += run.first + run.second;
+    }
+  }
+  return runs;
+}
+
+template<class Decoder>
+void
+decodeBenchmark(const std::vector<CompressedRecord>& records, size_type rounds, const std::string& name, size_type& runs, size_type& checksum)
+{
+  double start = readTimer();
+  for(size_type round = 0; round < rounds; round++) { runs += decodeRecords<Decoder>(records, checksum); }
+  double seconds = readTimer() - start;
+  printTime(name, runs, seconds);
+}
+
+void
+decodeBenchmark(const GBWT& compressed_index)
+{
+  std::cout << "Run decoding benchmarks:" << std::endl;
+
+  // Decode the outgoing edges in advance and repeat until we have enough runs.
+  const size_type MIN_RUNS = 10000000;
+  std::vector<CompressedRecord> records;
+  for(comp_type comp = 0; comp < compressed_index.effective(); comp++)
+  {
+    CompressedRecord record = compressed_index.bwt.record(comp);
+    if(record.outdegree() > 0) { records.push_back(record); }
+  }
+  size_type rounds = MIN_RUNS / std::max(compressed_index.runs(), static_cast<size_type>(1)) + 1;
+
+  size_type division_runs = 0, division_checksum = 0;
+  decodeBenchmark<DivisionDecoder>(records, rounds, "Division", division_runs, division_checksum);
+  size_type reciprocal_runs = 0, reciprocal_checksum = 0;
+  decodeBenchmark<Run>(records, rounds, "Reciprocal", reciprocal_runs, reciprocal_checksum);
+
+  if(division_runs != reciprocal_runs || division_checksum != reciprocal_checksum)
+  {
+    std::cerr << "decodeBenchmark(): Decoder mismatch: "
+              << division_runs << " runs (checksum " << division_checksum << "), "
+              << reciprocal_runs << " runs (checksum " << reciprocal_checksum << ")" << std::endl;
+  }
+
   std::cout << std::endl;
 }
 
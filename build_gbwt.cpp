@@ -24,9 +24,11 @@
 */
 
 #include <random>
+#include <sstream>
 #include <unistd.h>
 
 #include <gbwt/dynamic_gbwt.h>
+#include <gbwt/fast_locate.h>
 
 using namespace gbwt;
 
@@ -45,8 +47,10 @@ void printUsage(int exit_code = EXIT_SUCCESS);
 
 std::vector<SearchState> verifyFind(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, const std::string& query_base);
 void verifyLocate(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, const std::vector<SearchState>& queries);
+void verifyFastLocate(const GBWT& compressed_index, const FastLocate& r_index, const std::string& query_base);
 void verifyExtract(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, const std::string& base_name, bool both_orientations);
 void verifySamples(const GBWT& compressed_index, const DynamicGBWT& dynamic_index);
+void verifySampleBlocks(const GBWT& compressed_index);
 
 //------------------------------------------------------------------------------
 
@@ -56,10 +60,14 @@ main(int argc, char** argv)
   if(argc < 2) { printUsage(); }
 
   size_type batch_size = DynamicGBWT::INSERT_BATCH_SIZE / MILLION;
-  bool verify_index = false, both_orientations = false;
+  size_type prefix_length = 0, prefix_bytes = PrefixTable::DEFAULT_MAX_BYTES / MEGABYTE;
+  bool verify_index = false, both_orientations = false, build_r_index = false;
+  SamplePolicy::policy_type sample_policy = SamplePolicy::INTERVAL;
+  size_type sample_interval = DynamicGBWT::SAMPLE_INTERVAL;
+  bool set_sampling = false;
   std::string index_base, input_base, output_base;
   int c = 0;
-  while((c = getopt(argc, argv, "b:fi:o:rv")) != -1)
+  while((c = getopt(argc, argv, "b:fi:o:p:P:rRs:S:v")) != -1)
   {
     switch(c)
     {
@@ -71,8 +79,23 @@ main(int argc, char** argv)
       index_base = optarg; break;
     case 'o':
       output_base = optarg; break;
+    case 'p':
+      prefix_length = std::stoul(optarg); break;
+    case 'P':
+      prefix_bytes = std::stoul(optarg); break;
     case 'r':
       both_orientations = true; break;
+    case 'R':
+      build_r_index = true; break;
+    case 's':
+      if(!SamplePolicy::parse(optarg, sample_policy))
+      {
+        std::cerr << "build_gbwt: Invalid sampling policy: " << optarg << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      set_sampling = true; break;
+    case 'S':
+      sample_interval = std::stoul(optarg); set_sampling = true; break;
     case 'v':
       verify_index = true; break;
     case '?':
@@ -86,6 +109,12 @@ main(int argc, char** argv)
   size_type input_size = 0;
   if(index_base.empty() && output_base.empty() && input_files == 1) { output_base = argv[optind]; }
   if(input_files == 0 || output_base.empty()) { printUsage(EXIT_FAILURE); }
+  if(sample_policy == SamplePolicy::DENSE) { sample_interval = 1; }
+  if(prefix_length != 0 && (prefix_length < PrefixTable::MIN_LENGTH || prefix_length > PrefixTable::MAX_LENGTH))
+  {
+    std::cerr << "build_gbwt: Prefix table path length must be " << PrefixTable::MIN_LENGTH << " to " << PrefixTable::MAX_LENGTH << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
   if(verify_index && !(input_files == 1 && index_base.empty()))
   {
     std::cerr << "build_gbwt: Verification only works with indexes for a single file" << std::endl;
@@ -99,6 +128,9 @@ main(int argc, char** argv)
   printHeader("Output name"); std::cout << output_base << std::endl;
   if(batch_size != 0) { printHeader("Batch size"); std::cout << batch_size << " million" << std::endl; }
   printHeader("Orientation"); std::cout << (both_orientations ? "both" : "forward only") << std::endl;
+  if(prefix_length > 0) { printHeader("Prefix table"); std::cout << "length " << prefix_length << ", at most " << prefix_bytes << " MB" << std::endl; }
+  if(build_r_index) { printHeader("r-index"); std::cout << "enabled" << std::endl; }
+  if(set_sampling) { printHeader("Sampling"); std::cout << SamplePolicy::name(sample_policy) << " (interval " << sample_interval << ")" << std::endl; }
   std::cout << std::endl;
 
   double start = readTimer();
@@ -109,6 +141,10 @@ main(int argc, char** argv)
     sdsl::load_from_file(dynamic_index, index_base + DynamicGBWT::EXTENSION);
     printStatistics(dynamic_index, index_base);
   }
+  if(set_sampling && !(dynamic_index.setSampling(sample_policy, sample_interval)))
+  {
+    std::exit(EXIT_FAILURE);
+  }
 
   while(optind < argc)
   {
@@ -131,6 +167,30 @@ main(int argc, char** argv)
   std::cout << "Memory usage " << inGigabytes(memoryUsage()) << " GB" << std::endl;
   std::cout << std::endl;
 
+  if(prefix_length > 0)
+  {
+    double prefix_start = readTimer();
+    GBWT compressed_index;
+    sdsl::load_from_file(compressed_index, gbwt_name);
+    compressed_index.setPrefixTable(prefix_length, prefix_bytes * MEGABYTE);
+    sdsl::store_to_file(compressed_index.prefix_table, output_base + PrefixTable::EXTENSION);
+    double prefix_seconds = readTimer() - prefix_start;
+    std::cout << "Built a prefix table with " << compressed_index.prefix_table.size() << " paths in " << prefix_seconds << " seconds" << std::endl;
+    std::cout << std::endl;
+  }
+
+  if(build_r_index)
+  {
+    double r_index_start = readTimer();
+    GBWT compressed_index;
+    sdsl::load_from_file(compressed_index, gbwt_name);
+    FastLocate r_index(compressed_index);
+    sdsl::store_to_file(r_index, output_base + FastLocate::EXTENSION);
+    double r_index_seconds = readTimer() - r_index_start;
+    std::cout << "Built an r-index with " << r_index.runs() << " runs in " << r_index_seconds << " seconds" << std::endl;
+    std::cout << std::endl;
+  }
+
   if(verify_index)
   {
     std::cout << "Verifying the index..." << std::endl;
@@ -144,8 +204,16 @@ main(int argc, char** argv)
 
     std::vector<SearchState> results = verifyFind(compressed_index, dynamic_index, input_base);
     verifyLocate(compressed_index, dynamic_index, results);
+    if(build_r_index)
+    {
+      FastLocate r_index;
+      sdsl::load_from_file(r_index, output_base + FastLocate::EXTENSION);
+      if(r_index.setGBWT(compressed_index)) { verifyFastLocate(compressed_index, r_index, input_base); }
+      else { errors++; }
+    }
     verifyExtract(compressed_index, dynamic_index, input_base, both_orientations);
     verifySamples(compressed_index, dynamic_index);
+    verifySampleBlocks(compressed_index);
 
     double verify_seconds = readTimer() - verify_start;
     if(errors > 0) { std::cout << "Index verification failed" << std::endl; }
@@ -168,7 +236,12 @@ printUsage(int exit_code)
   std::cerr << "  -f    Index the sequences only in forward orientation (default)" << std::endl;
   std::cerr << "  -i X  Insert the sequences into an existing index with base name X" << std::endl;
   std::cerr << "  -o X  Use base name X for output (default: the only input)" << std::endl;
+  std::cerr << "  -p N  Build a prefix table for paths of N nodes (" << PrefixTable::MIN_LENGTH << " or " << PrefixTable::MAX_LENGTH << ")" << std::endl;
+  std::cerr << "  -P N  Limit the size of the prefix table to N MB (default: " << (PrefixTable::DEFAULT_MAX_BYTES / MEGABYTE) << ")" << std::endl;
   std::cerr << "  -r    Index the sequences also in reverse orientation" << std::endl;
+  std::cerr << "  -R    Build an r-index for fast locate() queries" << std::endl;
+  std::cerr << "  -s X  Use sampling policy X (interval, branching, degree, dense; default: interval)" << std::endl;
+  std::cerr << "  -S N  Use sample interval N (default: " << DynamicGBWT::SAMPLE_INTERVAL << ")" << std::endl;
   std::cerr << "  -v    Verify the index after construction" << std::endl;
   std::cerr << std::endl;
 
@@ -347,6 +420,69 @@ verifyLocate(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, con
   std::cout << std::endl;
 }
 
+/*
+  Compare the r-index to the GBWT with the text position from FastLocate::find(),
+  without a text position, and with extend() starting without a text position.
+*/
+void
+verifyFastLocate(const GBWT& compressed_index, const FastLocate& r_index, const std::string& query_base)
+{
+  std::cout << "Verifying r-index locate()..." << std::endl;
+
+  double start = readTimer();
+  size_type initial_errors = errors;
+  std::vector<std::vector<node_type>> queries = generateQueries(query_base);
+  std::vector<range_type> blocks = Range::partition(range_type(0, queries.size() - 1), 4 * omp_get_max_threads());
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_type block = 0; block < blocks.size(); block++)
+  {
+    for(size_type i = blocks[block].first; i <= blocks[block].second; i++)
+    {
+      SearchState query = compressed_index.find(queries[i].begin(), queries[i].end());
+      size_type first = invalid_offset();
+      SearchState r_index_query = r_index.find(queries[i].begin(), queries[i].end(), first);
+      if(query.empty() && r_index_query.empty()) { continue; }  // Failed searches may report different nodes.
+
+      size_type compressed_fast = fastLocate(compressed_index, query);
+      size_type r_index_fast = FNV_OFFSET_BASIS;
+      for(size_type res : r_index.locate(r_index_query, first)) { r_index_fast = fnv1a_hash(res, r_index_fast); }
+      size_type r_index_fallback = fastLocate(r_index, query);
+
+      // extend() starting without the text position.
+      SearchState unknown_query = gbwt::find(compressed_index, queries[i].front());
+      size_type unknown_first = invalid_offset();
+      for(size_type j = 1; j < queries[i].size() && !(unknown_query.empty()); j++)
+      {
+        unknown_query = r_index.extend(unknown_query, queries[i][j], unknown_first);
+      }
+      size_type r_index_unknown = FNV_OFFSET_BASIS;
+      for(size_type res : r_index.locate(unknown_query, unknown_first)) { r_index_unknown = fnv1a_hash(res, r_index_unknown); }
+
+      if(query != r_index_query || compressed_fast != r_index_fast || compressed_fast != r_index_fallback || compressed_fast != r_index_unknown)
+      {
+        #pragma omp critical
+        {
+          errors++;
+          if(errors <= MAX_ERRORS)
+          {
+            std::cerr << "verifyFastLocate(): Mismatch with query " << i << std::endl;
+            std::cerr << "verifyFastLocate(): " << query << " (compressed), " << r_index_query << " (r-index)" << std::endl;
+            std::cerr << "verifyFastLocate(): " << compressed_fast << " (compressed), " << r_index_fast << " (r-index), "
+                      << r_index_fallback << " (r-index without first), "
+                      << r_index_unknown << " (r-index extend() without first)" << std::endl;
+          }
+        }
+      }
+    }
+  }
+
+  double seconds = readTimer() - start;
+  if(errors > initial_errors) { std::cout << "r-index locate() verification failed" << std::endl; }
+  else { std::cout << "r-index locate() verified in " << seconds << " seconds" << std::endl; }
+  std::cout << std::endl;
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -453,89 +589,94 @@ verifyExtract(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, co
 
 //------------------------------------------------------------------------------
 
-/*
-  Ensure that all samples have the correct sequence identifiers.
-*/
+void
+verifySamples(const GBWT& compressed_index, const DynamicGBWT& dynamic_index)
+{
+  std::cout << "Verifying samples..." << std::endl;
 
-template<class GBWTType>
-bool
-trySample(const GBWTType& index, size_type sequence, edge_type& current, std::atomic<size_type>& samples_found)
+  double start = readTimer();
+  size_type initial_errors = errors;
+  errors += gbwt::verifySamples(compressed_index, dynamic_index, (errors < MAX_ERRORS ? MAX_ERRORS - errors : 0));
+
+  double seconds = readTimer() - start;
+  if(errors > initial_errors) { std::cout << "Sample verification failed" << std::endl; }
+  else { std::cout << "Samples verified in " << seconds << " seconds" << std::endl; }
+  std::cout << std::endl;
+}
+
+void
+reportBlockError(size_type record, size_type offset, const std::string& message)
 {
-  size_type sample = index.tryLocate(current);
-  if(sample != invalid_sequence())
+  errors++;
+  if(errors <= MAX_ERRORS)
   {
-    samples_found++;
-    if(sample != sequence)
-    {
-      #pragma omp critical
-      {
-        errors++;
-        if(errors <= MAX_ERRORS)
-        {
-          std::cerr << "verifySamples(): " << indexType(index) << ": Verification failed with sequence " << sequence << ", position " << current << std::endl;
-          std::cerr << "verifySamples(): Sample had sequence id " << sample << std::endl;
-        }
-      }
-      return false;
-    }
+    std::cerr << "verifySampleBlocks(): Record " << record << ", offset " << offset << ": " << message << std::endl;
   }
-  current = index.LF(current);
-  return true;
 }
 
+/*
+  Compare tryLocate() and nextSample(), which use the blocks, to the samples in the
+  serialized representation. The sd_vectors are regenerated by serialize() and parsed
+  here without the blocks.
+*/
 void
-verifySamples(const GBWT& compressed_index, const DynamicGBWT& dynamic_index)
+verifySampleBlocks(const GBWT& compressed_index)
 {
-  std::cout << "Verifying samples..." << std::endl;
+  std::cout << "Verifying sample blocks..." << std::endl;
 
   double start = readTimer();
   size_type initial_errors = errors;
-  std::atomic<size_type> found_compressed(0), found_dynamic(0);
-  std::vector<range_type> blocks = Range::partition(range_type(0, compressed_index.sequences() - 1), 4 * omp_get_max_threads());
+  const DASamples& samples = compressed_index.da_samples;
+
+  std::stringstream buffer;
+  samples.serialize(buffer);
+  sdsl::bit_vector sampled_records; sampled_records.load(buffer);
+  sdsl::bit_vector::rank_1_type record_rank; record_rank.load(buffer, &sampled_records);
+  sdsl::sd_vector<> bwt_ranges; bwt_ranges.load(buffer);
+  sdsl::sd_vector<>::select_1_type bwt_select; bwt_select.load(buffer, &bwt_ranges);
+  sdsl::sd_vector<> sampled_offsets; sampled_offsets.load(buffer);
+  sdsl::sd_vector<>::rank_1_type sample_rank; sample_rank.load(buffer, &sampled_offsets);
+  sdsl::int_vector<0> ids; ids.load(buffer);
+  sdsl::sd_vector<>::select_1_type offset_select(&sampled_offsets);
+  if(ids.size() != samples.size())
+  {
+    errors++;
+    std::cerr << "verifySampleBlocks(): Expected " << samples.size() << " samples, found " << ids.size() << std::endl;
+  }
 
-  #pragma omp parallel for schedule(dynamic, 1)
-  for(size_type block = 0; block < blocks.size(); block++)
+  size_type record_count = record_rank(sampled_records.size()), curr = 0;
+  for(size_type record = 0; record < samples.records(); record++)
   {
-    for(size_type sequence = blocks[block].first; sequence <= blocks[block].second; sequence++)
+    if(!(sampled_records[record]))
     {
-      edge_type curr_compressed(ENDMARKER, sequence), curr_dynamic(ENDMARKER, sequence);
-      do
+      if(samples.nextSample(record, 0) != invalid_sample()) { reportBlockError(record, 0, "Sample in an unsampled record"); }
+      continue;
+    }
+    size_type rank = record_rank(record);
+    size_type record_start = bwt_select(rank + 1);
+    size_type record_limit = (rank + 1 < record_count ? bwt_select(rank + 2) : bwt_ranges.size());
+    size_type next_offset = 0; // First offset after the previous sample.
+    while(curr < ids.size() && offset_select(curr + 1) < record_limit)
+    {
+      sample_type expected(offset_select(curr + 1) - record_start, ids[curr]);
+      if(samples.tryLocate(record, expected.first) != expected.second) { reportBlockError(record, expected.first, "tryLocate() mismatch"); }
+      if(samples.nextSample(record, next_offset) != expected) { reportBlockError(record, next_offset, "nextSample() mismatch"); }
+      if(next_offset < expected.first && samples.tryLocate(record, next_offset) != invalid_sequence())
       {
-        if(!trySample(compressed_index, sequence, curr_compressed, found_compressed)) { break; }
-        if(!trySample(dynamic_index, sequence, curr_dynamic, found_dynamic)) { break; }
-        if(curr_compressed != curr_dynamic)
-        {
-          #pragma omp critical
-          {
-            errors++;
-            if(errors <= MAX_ERRORS)
-            {
-              std::cerr << "verifySamples(): Position mismatch between indexes" << std::endl;
-              std::cerr << "verifySamples(): " << indexType(compressed_index) << ": " << curr_compressed << ", "
-                << indexType(dynamic_index) << ": " << curr_dynamic << std::endl;
-            }
-          }
-          break;
-        }
+        reportBlockError(record, next_offset, "tryLocate() found a sample at an unsampled offset");
       }
-      while(curr_compressed.first != ENDMARKER);
+      next_offset = expected.first + 1;
+      curr++;
     }
-  }
-
-  if(found_compressed != compressed_index.samples() || found_dynamic != dynamic_index.samples() || found_compressed != found_dynamic)
-  {
-    errors++;
-    if(errors <= MAX_ERRORS)
+    if(next_offset < record_limit - record_start && samples.nextSample(record, next_offset) != invalid_sample())
     {
-      std::cerr << "verifySamples(): Mismatch in the number of samples" << std::endl;
-      std::cerr << "verifySamples(): " << indexType(compressed_index) << ": " << found_compressed << ", "
-        << indexType(dynamic_index) << ": " << found_dynamic << std::endl;
+      reportBlockError(record, next_offset, "nextSample() found a sample after the last sample");
     }
   }
 
   double seconds = readTimer() - start;
-  if(errors > initial_errors) { std::cout << "Sample verification failed" << std::endl; }
-  else { std::cout << "Samples verified in " << seconds << " seconds" << std::endl; }
+  if(errors > initial_errors) { std::cout << "Sample block verification failed" << std::endl; }
+  else { std::cout << "Sample blocks verified in " << seconds << " seconds" << std::endl; }
   std::cout << std::endl;
 }
 
@@ -0,0 +1,380 @@
+/*
+  Copyright (c) 2017 Jouni Siren
+  Copyright (c) 2017 Genome Research Ltd.
+
+  Author: Jouni Siren <jouni.siren@iki.fi>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include <gbwt/cached_gbwt.h>
+#include <gbwt/internal.h>
+
+namespace gbwt
+{
+
+//------------------------------------------------------------------------------
+
+size_type
+CachedRecord::rank(size_type i, rank_type outrank) const
+{
+  size_type offset = 0, result = 0;
+  for(run_type run : this->runs)
+  {
+    if(offset >= i) { break; }
+    if(run.first == outrank) { result += std::min<size_type>(run.second, i - offset); }
+    offset += run.second;
+  }
+  return result;
+}
+
+edge_type
+CachedRecord::LF(size_type i) const
+{
+  if(!(this->decoded)) { return this->compressed.LF(i); }
+  if(i >= this->size()) { return invalid_edge(); }
+
+  size_type offset = 0;
+  for(run_type run : this->runs)
+  {
+    offset += run.second;
+    if(offset > i)
+    {
+      return edge_type(this->successor(run.first), this->offset(run.first) + this->rank(i, run.first));
+    }
+  }
+  return invalid_edge();
+}
+
+size_type
+CachedRecord::LF(size_type i, node_type to) const
+{
+  if(!(this->decoded)) { return this->compressed.LF(i, to); }
+
+  rank_type outrank = this->edgeTo(to);
+  if(outrank >= this->outdegree()) { return invalid_offset(); }
+  return this->offset(outrank) + this->rank(i, outrank);
+}
+
+range_type
+CachedRecord::LF(range_type range, node_type to) const
+{
+  if(!(this->decoded)) { return this->compressed.LF(range, to); }
+  if(Range::empty(range)) { return Range::empty_range(); }
+
+  rank_type outrank = this->edgeTo(to);
+  if(outrank >= this->outdegree()) { return Range::empty_range(); }
+  return range_type(this->offset(outrank) + this->rank(range.first, outrank),
+                    this->offset(outrank) + this->rank(range.second + 1, outrank) - 1);
+}
+
+std::vector<edge_type>
+CachedRecord::LF(const std::vector<size_type>& positions) const
+{
+  std::vector<edge_type> result; result.reserve(positions.size());
+  this->LF(positions, result);
+  return result;
+}
+
+void
+CachedRecord::LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+{
+  if(!(this->decoded)) { this->compressed.LF(positions, result); return; }
+
+  result.clear();
+  for(size_type i : positions) { result.push_back(this->LF(i)); }
+}
+
+std::vector<range_type>
+CachedRecord::LF(const std::vector<range_type>& ranges, node_type to) const
+{
+  if(!(this->decoded)) { return this->compressed.LF(ranges, to); }
+
+  std::vector<range_type> result; result.reserve(ranges.size());
+  for(range_type range : ranges) { result.push_back(this->LF(range, to)); }
+  return result;
+}
+
+std::vector<range_type>
+CachedRecord::LF(range_type range) const
+{
+  if(!(this->decoded)) { return this->compressed.LF(range); }
+
+  std::vector<range_type> result(this->outdegree(), Range::empty_range());
+  if(Range::empty(range) || this->outdegree() == 0) { return result; }
+
+  for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
+  {
+    result[outrank].first = result[outrank].second = this->offset(outrank);
+  }
+  size_type offset = 0;
+  for(run_type run : this->runs)
+  {
+    if(offset >= range.second + 1) { break; }
+    if(offset < range.first) { result[run.first].first += std::min<size_type>(run.second, range.first - offset); }
+    result[run.first].second += std::min<size_type>(run.second, range.second + 1 - offset);
+    offset += run.second;
+  }
+  for(range_type& successor : result) { successor.second--; }
+
+  return result;
+}
+
+node_type
+CachedRecord::operator[](size_type i) const
+{
+  if(!(this->decoded)) { return this->compressed[i]; }
+
+  size_type offset = 0;
+  for(run_type run : this->runs)
+  {
+    offset += run.second;
+    if(offset > i) { return this->successor(run.first); }
+  }
+  return ENDMARKER;
+}
+
+//------------------------------------------------------------------------------
+
+const size_type CachedGBWT::DEFAULT_CAPACITY;
+const size_type CachedGBWT::MAX_DECODED_RUNS;
+
+CachedGBWT::CachedGBWT(const GBWT& graph, size_type capacity) :
+  index(&graph), cache_hits(0), cache_misses(0)
+{
+  size_type cache_size = 1;
+  while(cache_size < capacity) { cache_size *= 2; }
+  this->cache.resize(cache_size);
+  this->mask = cache_size - 1;
+}
+
+void
+CachedGBWT::swap(CachedGBWT& another)
+{
+  if(this != &another)
+  {
+    std::swap(this->index, another.index);
+    this->cache.swap(another.cache);
+    std::swap(this->mask, another.mask);
+    std::swap(this->cache_hits, another.cache_hits);
+    std::swap(this->cache_misses, another.cache_misses);
+  }
+}
+
+void
+CachedGBWT::clearCache()
+{
+  for(CachedRecord& entry : this->cache)
+  {
+    entry.node = invalid_node();
+    entry.runs.clear();
+  }
+  this->cache_hits = this->cache_misses = 0;
+}
+
+void
+CachedGBWT::decode(node_type node, CachedRecord& entry) const
+{
+  entry.node = node;
+  entry.compressed = this->index->record(node);
+  entry.record_size = this->index->nodeSize(node);
+  entry.decoded = false;
+  entry.runs.clear();
+  if(entry.compressed.outdegree() == 0) { entry.decoded = true; return; }
+
+  // Decode the body if it is short enough.
+  for(CompressedRecordIterator iter(entry.compressed); !(iter.end()); ++iter)
+  {
+    if(entry.runs.size() >= MAX_DECODED_RUNS) { entry.runs.clear(); return; }
+    entry.runs.push_back(*iter);
+  }
+  entry.decoded = true;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<size_type>
+CachedGBWT::locate(SearchState state) const
+{
+  std::vector<size_type> result;
+  QueryContext context;
+  this->locate(state, result, context);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+const size_type ResultCache::DEFAULT_CAPACITY;
+const size_type ResultCache::LOCATE_COST;
+const size_type ResultCache::ENTRY_OVERHEAD;
+
+ResultCache::ResultCache(const GBWT& graph, size_type capacity_bytes) :
+  index(&graph), max_bytes(capacity_bytes), used_bytes(0), inflation(0.0),
+  cache_hits(0), cache_misses(0), cache_evictions(0)
+{
+}
+
+void
+ResultCache::clear()
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  this->queue.clear();
+  this->entries.clear();
+  this->used_bytes = 0;
+  this->inflation = 0.0;
+  this->cache_hits = this->cache_misses = this->cache_evictions = 0;
+}
+
+//------------------------------------------------------------------------------
+
+SearchState
+ResultCache::find(const std::vector<node_type>& pattern)
+{
+  key_type key; key.reserve(pattern.size() + 1);
+  key.push_back(QUERY_FIND);
+  key.insert(key.end(), pattern.begin(), pattern.end());
+
+  Entry entry;
+  if(this->lookup(key, entry)) { return entry.state; }
+  entry.state = this->index->find(pattern.begin(), pattern.end());
+  this->insert(key, entry, pattern.size());
+  return entry.state;
+}
+
+std::vector<size_type>
+ResultCache::locate(SearchState state)
+{
+  key_type key { QUERY_LOCATE, state.node, state.range.first, state.range.second };
+
+  Entry entry;
+  if(this->lookup(key, entry)) { return entry.values; }
+  entry.values = this->index->locate(state);
+  this->insert(key, entry, LOCATE_COST * (state.empty() ? 1 : state.size()));
+  return entry.values;
+}
+
+std::vector<node_type>
+ResultCache::extract(size_type sequence)
+{
+  key_type key { QUERY_EXTRACT, sequence };
+
+  Entry entry;
+  if(this->lookup(key, entry)) { return entry.values; }
+  entry.values = this->index->extract(sequence);
+  this->insert(key, entry, entry.values.size() + 1);
+  return entry.values;
+}
+
+//------------------------------------------------------------------------------
+
+size_type
+ResultCache::size() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  return this->entries.size();
+}
+
+size_type
+ResultCache::bytes() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  return this->used_bytes;
+}
+
+size_type
+ResultCache::hits() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  return this->cache_hits;
+}
+
+size_type
+ResultCache::misses() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  return this->cache_misses;
+}
+
+size_type
+ResultCache::evictions() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  return this->cache_evictions;
+}
+
+double
+ResultCache::hitRate() const
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  size_type total = this->cache_hits + this->cache_misses;
+  return (total > 0 ? this->cache_hits / static_cast<double>(total) : 0.0);
+}
+
+//------------------------------------------------------------------------------
+
+bool
+ResultCache::lookup(const key_type& key, Entry& result)
+{
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  map_type::iterator iter = this->entries.find(key);
+  if(iter == this->entries.end()) { this->cache_misses++; return false; }
+  this->cache_hits++;
+
+  // Restore the priority of the entry.
+  Entry& entry = iter->second;
+  this->queue.erase(std::make_pair(entry.priority, &(iter->first)));
+  entry.priority = this->inflation + entry.weight;
+  this->queue.insert(std::make_pair(entry.priority, &(iter->first)));
+
+  result.state = entry.state;
+  result.values = entry.values;
+  return true;
+}
+
+void
+ResultCache::insert(const key_type& key, Entry& entry, size_type cost)
+{
+  entry.bytes = ENTRY_OVERHEAD + sizeof(size_type) * (key.size() + entry.values.size());
+  if(entry.bytes > this->max_bytes) { return; }
+  entry.weight = cost / static_cast<double>(entry.bytes);
+
+  std::lock_guard<std::mutex> lock(this->cache_mutex);
+  if(this->entries.find(key) != this->entries.end()) { return; } // Another thread was faster.
+
+  // Evict the entries with the lowest priority.
+  while(this->used_bytes + entry.bytes > this->max_bytes)
+  {
+    queue_type::iterator victim = this->queue.begin();
+    this->inflation = victim->first;
+    map_type::iterator iter = this->entries.find(*(victim->second));
+    this->used_bytes -= iter->second.bytes;
+    this->queue.erase(victim);
+    this->entries.erase(iter);
+    this->cache_evictions++;
+  }
+
+  entry.priority = this->inflation + entry.weight;
+  std::pair<map_type::iterator, bool> result = this->entries.emplace(key, entry);
+  this->queue.insert(std::make_pair(entry.priority, &(result.first->first)));
+  this->used_bytes += entry.bytes;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwt
@@ -58,6 +58,7 @@ DynamicGBWT::swap(DynamicGBWT& another)
   {
     this->header.swap(another.header);
     this->bwt.swap(another.bwt);
+    this->sequence_starts.swap(another.sequence_starts);
   }
 }
 
@@ -75,6 +76,7 @@ DynamicGBWT::operator=(DynamicGBWT&& source)
   {
     this->header = std::move(source.header);
     this->bwt = std::move(source.bwt);
+    this->sequence_starts = std::move(source.sequence_starts);
   }
   return *this;
 }
@@ -97,6 +99,15 @@ DynamicGBWT::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::str
     written_bytes += compressed_samples.serialize(out, child, "da_samples");
   }
 
+  // recode() rebuilds the starts, and the index must be recoded before serialization.
+  written_bytes += this->sequence_starts.serialize(out, child, "sequence_starts");
+
+  {
+    const std::vector<DynamicRecord>& records = this->bwt;
+    RecordSizes sizes(this->effective(), this->size(), [&records](size_type i) { return records[i].size(); });
+    written_bytes += sizes.serialize(out, child, "record_sizes");
+  }
+
   sdsl::structure_tree::add_size(child, written_bytes);
   return written_bytes;
 }
@@ -124,14 +135,8 @@ DynamicGBWT::load(std::istream& in)
       current.clear();
 
       // Decompress the outgoing edges.
-      current.outgoing.resize(ByteCode::read(array.data, offset));
-      node_type prev = 0;
-      for(edge_type& outedge : current.outgoing)
-      {
-        outedge.first = ByteCode::read(array.data, offset) + prev;
-        prev = outedge.first;
-        outedge.second = ByteCode::read(array.data, offset);
-      }
+      current.outgoing.resize(ByteCode::read(array.data.data(), offset, limit));
+      ByteCode::readEdges(array.data.data(), offset, limit, current.outgoing.data(), current.outdegree());
 
       // Decompress the body.
       if(current.outdegree() > 0)
@@ -163,6 +168,18 @@ DynamicGBWT::load(std::istream& in)
     }
   }
 
+  // Read or rebuild the sequence start directory. Older versions do not have it.
+  if(this->header.version >= 2) { this->sequence_starts.load(in); }
+  else if(this->effective() > 0) { this->sequence_starts = SequenceStarts(this->bwt[ENDMARKER]); }
+
+  // The record sizes are already stored in the records.
+  if(this->header.version >= 3)
+  {
+    RecordSizes sizes;
+    sizes.load(in);
+  }
+  this->header.version = GBWTHeader::VERSION;
+
   // Rebuild the incoming edges.
   for(comp_type comp = 0; comp < this->effective(); comp++)
   {
@@ -185,6 +202,7 @@ DynamicGBWT::copy(const DynamicGBWT& source)
 {
   this->header = source.header;
   this->bwt = source.bwt;
+  this->sequence_starts = source.sequence_starts;
 }
 
 //------------------------------------------------------------------------------
@@ -259,6 +277,7 @@ DynamicGBWT::recode()
   }
 
   for(comp_type comp = 0; comp < this->effective(); comp++) { this->bwt[comp].recode(); }
+  if(this->effective() > 0) { this->sequence_starts = SequenceStarts(this->bwt[ENDMARKER]); }
 }
 
 //------------------------------------------------------------------------------
@@ -278,7 +297,7 @@ swapBody(DynamicRecord& record, RunMerger& merger)
 /*
   Process ranges of sequences sharing the same 'curr' node.
   - Add the outgoing edge (curr, next) if necessary.
-  - Add sample (offset, id) if iteration % SAMPLE_INTERVAL == 0 or next == ENDMARKER.
+  - Add sample (offset, id) if the sampling policy selects the position or next == ENDMARKER.
   - Insert the 'next' node into position 'offset' in the body.
   - Set 'offset' to rank(next) within the record.
   - Update the predecessor count of 'curr' in the incoming edges of 'next'.
@@ -304,7 +323,7 @@ updateRecords(DynamicGBWT& gbwt, std::vector<Sequence>& seqs, size_type iteratio
       rank_type outrank = current.edgeTo(seqs[i].next);
       if(outrank >= current.outdegree())  // Add edge (curr, next) if it does not exist.
       {
-        current.outgoing.push_back(edge_type(seqs[i].next, 0));
+        current.addOutgoing(seqs[i].next);
         new_body.addEdge();
       }
       while(new_body.size() < seqs[i].offset)  // Add old runs until 'offset'.
@@ -323,7 +342,8 @@ updateRecords(DynamicGBWT& gbwt, std::vector<Sequence>& seqs, size_type iteratio
         new_samples.push_back(sample_type(sample_iter->first + insert_count, sample_iter->second));
         ++sample_iter;
       }
-      if(iteration % DynamicGBWT::SAMPLE_INTERVAL == 0 || seqs[i].next == ENDMARKER)  // Sample sequence id.
+      if(seqs[i].next == ENDMARKER ||
+         SamplePolicy::sample(gbwt.header.sample_policy, gbwt.header.sample_interval, iteration, seqs[i].offset, current.outdegree()))  // Sample sequence id.
       {
         new_samples.push_back(sample_type(seqs[i].offset, seqs[i].id));
       }
@@ -593,6 +613,46 @@ insertBatch(DynamicGBWT& index, const IntegerVector& text, size_type text_length
 
 //------------------------------------------------------------------------------
 
+bool
+DynamicGBWT::setSampling(SamplePolicy::policy_type policy, size_type interval)
+{
+  GBWTHeader requested; requested.setSampling(policy, interval);
+  if(requested.sample_policy == this->header.sample_policy && requested.sample_interval == this->header.sample_interval)
+  {
+    return true;
+  }
+  if(!(this->empty()))
+  {
+    std::cerr << "DynamicGBWT::setSampling(): Cannot change " << SamplePolicy::name(this->header.sample_policy)
+              << " sampling with interval " << this->header.sample_interval << " in a non-empty GBWT" << std::endl;
+    return false;
+  }
+  this->header.setSampling(policy, interval);
+  return true;
+}
+
+void
+DynamicGBWT::resample(SamplePolicy::policy_type policy, size_type interval)
+{
+  double start = readTimer();
+
+  this->header.setSampling(policy, interval);
+  std::vector<std::pair<edge_type, size_type>> samples = gbwt::resampleSequences(*this, this->header.sample_policy, this->header.sample_interval);
+  for(DynamicRecord& record : this->bwt) { record.ids.clear(); }
+  for(const std::pair<edge_type, size_type>& sample : samples)
+  {
+    this->bwt[sample.first.first].ids.push_back(sample_type(sample.first.second, sample.second));
+  }
+
+  if(Verbosity::level >= Verbosity::BASIC)
+  {
+    double seconds = readTimer() - start;
+    std::cerr << "DynamicGBWT::resample(): Sampled " << samples.size() << " positions in " << seconds << " seconds" << std::endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 void
 DynamicGBWT::insert(const text_type& text)
 {
@@ -766,61 +826,20 @@ std::vector<size_type>
 DynamicGBWT::locate(SearchState state) const
 {
   std::vector<size_type> result;
-  if(!(this->contains(state))) { return result; }
-
-  // Initialize BWT positions for each offset in the range.
-  std::vector<edge_type> positions(state.size());
-  for(size_type i = state.range.first; i <= state.range.second; i++)
-  {
-    positions[i - state.range.first] = edge_type(state.node, i);
-  }
-
-  // Continue with LF() until samples have been found for all sequences.
-  while(!(positions.empty()))
-  {
-    size_type tail = 0;
-    node_type curr = invalid_node();
-    const DynamicRecord* current = 0;
-    std::vector<sample_type>::const_iterator sample;
-    edge_type LF_result;
-    range_type LF_range;
-
-    for(size_type i = 0; i < positions.size(); i++)
-    {
-      if(positions[i].first != curr)  // Node changed.
-      {
-        curr = positions[i].first; current = &(this->record(curr));
-        sample = current->nextSample(positions[i].second);
-        LF_range.first = positions[i].second;
-        LF_result = current->runLF(positions[i].second, LF_range.second);
-      }
-      while(sample != current->ids.end() && sample->first < positions[i].second)  // Went past the sample.
-      {
-        ++sample;
-      }
-      if(sample == current->ids.end() || sample->first > positions[i].second) // Not sampled.
-      {
-        if(positions[i].second > LF_range.second) // Went past the existing LF() result.
-        {
-          LF_range.first = positions[i].second;
-          LF_result = current->runLF(positions[i].second, LF_range.second);
-        }
-        positions[tail] = edge_type(LF_result.first, LF_result.second + positions[i].second - LF_range.first);
-        tail++;
-      }
-      else  // Found a sample.
-      {
-        result.push_back(sample->second);
-      }
-    }
-    positions.resize(tail);
-    sequentialSort(positions.begin(), positions.end());
-  }
-
-  removeDuplicates(result, false);
+  QueryContext context;
+  this->locate(state, result, context);
   return result;
 }
 
+sample_type
+DynamicGBWT::nextSample(node_type node, size_type i) const
+{
+  const DynamicRecord& record = this->record(node);
+  std::vector<sample_type>::const_iterator iter =
+    std::lower_bound(record.ids.begin(), record.ids.end(), i, [](const sample_type& sample, size_type offset) { return (sample.first < offset); });
+  return (iter == record.ids.end() ? invalid_sample() : *iter);
+}
+
 //------------------------------------------------------------------------------
 
 void
@@ -833,6 +852,7 @@ printStatistics(const DynamicGBWT& gbwt, const std::string& name)
   printHeader("Effective"); std::cout << gbwt.effective() << std::endl;
   printHeader("Runs"); std::cout << gbwt.runs() << std::endl;
   printHeader("Samples"); std::cout << gbwt.samples() << std::endl;
+  printHeader("Sampling"); std::cout << SamplePolicy::name(gbwt.header.sample_policy) << " (interval " << gbwt.header.sample_interval << ")" << std::endl;
   std::cout << std::endl;
 }
 
@@ -923,4 +943,85 @@ GBWTBuilder::flush()
 
 //------------------------------------------------------------------------------
 
+std::string indexType(const GBWT&) { return "Compressed GBWT"; }
+std::string indexType(const DynamicGBWT&) { return "Dynamic GBWT"; }
+
+void
+reportError(std::atomic<size_type>& errors, size_type max_errors, const std::string& first_line, const std::string& second_line)
+{
+  if(errors++ < max_errors)
+  {
+    #pragma omp critical
+    {
+      std::cerr << "verifySamples(): " << first_line << std::endl;
+      std::cerr << "verifySamples(): " << second_line << std::endl;
+    }
+  }
+}
+
+template<class GBWTType>
+bool
+trySample(const GBWTType& index, size_type sequence, edge_type& current, std::atomic<size_type>& samples_found,
+          std::atomic<size_type>& errors, size_type max_errors)
+{
+  size_type sample = index.tryLocate(current);
+  if(sample != invalid_sequence())
+  {
+    samples_found++;
+    if(sample != sequence)
+    {
+      std::ostringstream first_line, second_line;
+      first_line << indexType(index) << ": Verification failed with sequence " << sequence << ", position " << current;
+      second_line << "Sample had sequence id " << sample;
+      reportError(errors, max_errors, first_line.str(), second_line.str());
+      return false;
+    }
+  }
+  current = index.LF(current);
+  return true;
+}
+
+size_type
+verifySamples(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, size_type max_errors)
+{
+  std::atomic<size_type> errors(0), found_compressed(0), found_dynamic(0);
+  if(compressed_index.sequences() == 0 && dynamic_index.sequences() == 0) { return 0; }
+  std::vector<range_type> blocks = Range::partition(range_type(0, compressed_index.sequences() - 1), 4 * omp_get_max_threads());
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_type block = 0; block < blocks.size(); block++)
+  {
+    for(size_type sequence = blocks[block].first; sequence <= blocks[block].second; sequence++)
+    {
+      edge_type curr_compressed(ENDMARKER, sequence), curr_dynamic(ENDMARKER, sequence);
+      do
+      {
+        if(!trySample(compressed_index, sequence, curr_compressed, found_compressed, errors, max_errors)) { break; }
+        if(!trySample(dynamic_index, sequence, curr_dynamic, found_dynamic, errors, max_errors)) { break; }
+        if(curr_compressed != curr_dynamic)
+        {
+          std::ostringstream second_line;
+          second_line << indexType(compressed_index) << ": " << curr_compressed << ", "
+                      << indexType(dynamic_index) << ": " << curr_dynamic;
+          reportError(errors, max_errors, "Position mismatch between indexes", second_line.str());
+          break;
+        }
+      }
+      while(curr_compressed.first != ENDMARKER);
+    }
+  }
+
+  if(found_compressed != compressed_index.samples() || found_dynamic != dynamic_index.samples() || found_compressed != found_dynamic)
+  {
+    std::ostringstream second_line;
+    second_line << indexType(compressed_index) << ": " << found_compressed << ", "
+                << indexType(dynamic_index) << ": " << found_dynamic;
+    reportError(errors, max_errors, "Mismatch in the number of samples", second_line.str());
+  }
+
+  return errors;
+}
+
+//------------------------------------------------------------------------------
+
 } // namespace gbwt
@@ -0,0 +1,421 @@
+/*
+  Copyright (c) 2017 Jouni Siren
+  Copyright (c) 2017 Genome Research Ltd.
+
+  Author: Jouni Siren <jouni.siren@iki.fi>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include <gbwt/fast_locate.h>
+#include <gbwt/internal.h>
+
+namespace gbwt
+{
+
+//------------------------------------------------------------------------------
+
+const std::string FastLocate::EXTENSION = ".ri";
+
+FastLocate::FastLocate() :
+  index(nullptr),
+  max_length(1), node_offset(0), alphabet_size(0), total_length(0)
+{
+}
+
+/*
+  Construction:
+
+  1. Decode the runs of each record: the first offset and LF() at the first offset.
+  2. Extract all sequences in parallel. When a sequence visits the first or the last
+     position of a run, store the text position as a (sequence, offset) pair. The
+     positions are packed after the extraction, when the length of the longest
+     sequence is known.
+  3. If run r ends at position e and the successor is node w, the position following
+     LF(e) in record w is LF(f) for the first position f of the next run with successor
+     w in BWT order. Hence phi(end_text[r] + 1) = start_text[r'] + 1 for that run r'.
+*/
+
+FastLocate::FastLocate(const GBWT& source) :
+  index(&source),
+  max_length(1), node_offset(source.header.offset), alphabet_size(source.sigma()), total_length(source.size())
+{
+  if(source.empty()) { return; }
+  double start = readTimer();
+
+  // Count the runs in each record.
+  size_type records = source.effective();
+  std::vector<size_type> run_counts(records, 0), record_sizes(records, 0);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(comp_type comp = 0; comp < records; comp++)
+  {
+    if(comp == 0)
+    {
+      run_counts[comp] = record_sizes[comp] = source.sequences();
+      continue;
+    }
+    CompressedRecord record = source.bwt.record(comp);
+    if(record.outdegree() == 0) { continue; }
+    for(CompressedRecordIterator iter(record); !(iter.end()); ++iter)
+    {
+      run_counts[comp]++; record_sizes[comp] = iter.offset();
+    }
+  }
+  this->comp_to_run = sdsl::int_vector<0>(records + 1, 0, bit_length(source.size() + source.sequences()));
+  size_type total_runs = 0;
+  for(comp_type comp = 0; comp < records; comp++)
+  {
+    this->comp_to_run[comp] = total_runs;
+    total_runs += run_counts[comp];
+  }
+  this->comp_to_run[records] = total_runs;
+  std::vector<size_type>().swap(run_counts);
+
+  // Decode the runs.
+  std::vector<size_type> run_starts(total_runs, 0);
+  std::vector<edge_type> run_lf(total_runs, invalid_edge());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(comp_type comp = 0; comp < records; comp++)
+  {
+    size_type run = this->comp_to_run[comp];
+    if(comp == 0)
+    {
+      for(size_type i = 0; i < source.sequences(); i++, run++)
+      {
+        run_starts[run] = i; run_lf[run] = source.start(i);
+      }
+      continue;
+    }
+    CompressedRecord record = source.bwt.record(comp);
+    if(record.outdegree() == 0) { continue; }
+    for(CompressedRecordFullIterator iter(record); !(iter.end()); ++iter, run++)
+    {
+      run_starts[run] = iter.offset() - iter->second;
+      edge_type successor = iter.edge();
+      run_lf[run] = edge_type(successor.first, successor.second - iter->second);
+    }
+  }
+
+  // Extract the sequences.
+  size_type longest = 0;
+  std::vector<range_type> start_visit(total_runs, range_type(0, 0)), end_visit(total_runs, range_type(0, 0));
+  #pragma omp parallel for schedule(dynamic, 1) reduction(max:longest)
+  for(size_type sequence = 0; sequence < source.sequences(); sequence++)
+  {
+    size_type run = this->comp_to_run[0] + sequence, offset = 0;
+    start_visit[run] = end_visit[run] = range_type(sequence, 0);
+    edge_type position = run_lf[run];
+    while(position.first != ENDMARKER && position != invalid_edge())
+    {
+      offset++;
+      comp_type comp = source.toComp(position.first);
+      std::vector<size_type>::iterator first_run = run_starts.begin() + this->comp_to_run[comp];
+      std::vector<size_type>::iterator last_run = run_starts.begin() + this->comp_to_run[comp + 1];
+      run = (std::upper_bound(first_run, last_run, position.second) - run_starts.begin()) - 1;
+      size_type run_offset = position.second - run_starts[run];
+      size_type run_limit = (run + 1 < this->comp_to_run[comp + 1] ? run_starts[run + 1] : record_sizes[comp]);
+      if(run_offset == 0) { start_visit[run] = range_type(sequence, offset); }
+      if(position.second + 1 == run_limit) { end_visit[run] = range_type(sequence, offset); }
+      position = edge_type(run_lf[run].first, run_lf[run].second + run_offset);
+    }
+    longest = std::max(longest, offset);
+  }
+  std::vector<size_type>().swap(run_starts);
+  std::vector<size_type>().swap(record_sizes);
+  this->max_length = longest + 2;
+  size_type universe = source.sequences() * this->max_length;
+  std::vector<size_type> start_text(total_runs, 0), end_text(total_runs, 0);
+  for(size_type run = 0; run < total_runs; run++)
+  {
+    start_text[run] = this->pack(start_visit[run].first, start_visit[run].second);
+    end_text[run] = this->pack(end_visit[run].first, end_visit[run].second);
+  }
+  std::vector<range_type>().swap(start_visit);
+  std::vector<range_type>().swap(end_visit);
+
+  // Store the samples.
+  this->samples = sdsl::int_vector<0>(total_runs, 0, bit_length(universe - 1));
+  for(size_type run = 0; run < total_runs; run++) { this->samples[run] = start_text[run]; }
+
+  // Pair each run with the next run with the same successor.
+  std::vector<range_type> phi_pairs;
+  std::vector<size_type> previous(records, invalid_offset());
+  for(size_type run = 0; run < total_runs; run++)
+  {
+    node_type successor = run_lf[run].first;
+    if(successor == ENDMARKER || run_lf[run] == invalid_edge()) { continue; }
+    comp_type comp = source.toComp(successor);
+    if(previous[comp] != invalid_offset())
+    {
+      phi_pairs.push_back(range_type(end_text[previous[comp]] + 1, start_text[run] + 1));
+    }
+    previous[comp] = run;
+  }
+  std::vector<edge_type>().swap(run_lf);
+  std::vector<size_type>().swap(start_text);
+  std::vector<size_type>().swap(end_text);
+  std::vector<size_type>().swap(previous);
+  parallelQuickSort(phi_pairs.begin(), phi_pairs.end());
+
+  // Build the phi() structure.
+  sdsl::sd_vector_builder builder(universe, phi_pairs.size());
+  this->phi_values = sdsl::int_vector<0>(phi_pairs.size(), 0, bit_length(universe - 1));
+  for(size_type i = 0; i < phi_pairs.size(); i++)
+  {
+    builder.set(phi_pairs[i].first);
+    this->phi_values[i] = phi_pairs[i].second;
+  }
+  this->phi_keys = sdsl::sd_vector<>(builder);
+  sdsl::util::init_support(this->phi_rank, &(this->phi_keys));
+  sdsl::util::init_support(this->phi_select, &(this->phi_keys));
+
+  if(Verbosity::level >= Verbosity::BASIC)
+  {
+    double seconds = readTimer() - start;
+    std::cerr << "FastLocate::FastLocate(): " << this->runs() << " runs and " << this->keys()
+              << " phi() keys in " << seconds << " seconds" << std::endl;
+  }
+}
+
+void
+FastLocate::swap(FastLocate& another)
+{
+  if(this != &another)
+  {
+    std::swap(this->index, another.index);
+
+    std::swap(this->max_length, another.max_length);
+    std::swap(this->node_offset, another.node_offset);
+    std::swap(this->alphabet_size, another.alphabet_size);
+    std::swap(this->total_length, another.total_length);
+
+    this->samples.swap(another.samples);
+    this->comp_to_run.swap(another.comp_to_run);
+
+    this->phi_keys.swap(another.phi_keys);
+    sdsl::util::swap_support(this->phi_rank, another.phi_rank, &(this->phi_keys), &(another.phi_keys));
+    sdsl::util::swap_support(this->phi_select, another.phi_select, &(this->phi_keys), &(another.phi_keys));
+    this->phi_values.swap(another.phi_values);
+  }
+}
+
+size_type
+FastLocate::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+{
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += sdsl::write_member(this->max_length, out, child, "max_length");
+  written_bytes += sdsl::write_member(this->node_offset, out, child, "node_offset");
+  written_bytes += sdsl::write_member(this->alphabet_size, out, child, "alphabet_size");
+  written_bytes += sdsl::write_member(this->total_length, out, child, "total_length");
+
+  written_bytes += this->samples.serialize(out, child, "samples");
+  written_bytes += this->comp_to_run.serialize(out, child, "comp_to_run");
+
+  written_bytes += this->phi_keys.serialize(out, child, "phi_keys");
+  written_bytes += this->phi_rank.serialize(out, child, "phi_rank");
+  written_bytes += this->phi_select.serialize(out, child, "phi_select");
+  written_bytes += this->phi_values.serialize(out, child, "phi_values");
+
+  sdsl::structure_tree::add_size(child, written_bytes);
+  return written_bytes;
+}
+
+void
+FastLocate::load(std::istream& in)
+{
+  this->index = nullptr;
+
+  sdsl::read_member(this->max_length, in);
+  sdsl::read_member(this->node_offset, in);
+  sdsl::read_member(this->alphabet_size, in);
+  sdsl::read_member(this->total_length, in);
+
+  this->samples.load(in);
+  this->comp_to_run.load(in);
+
+  this->phi_keys.load(in);
+  this->phi_rank.load(in, &(this->phi_keys));
+  this->phi_select.load(in, &(this->phi_keys));
+  this->phi_values.load(in);
+}
+
+bool
+FastLocate::setGBWT(const GBWT& source)
+{
+  if(this->node_offset != source.header.offset || this->alphabet_size != source.sigma() || this->total_length != source.size())
+  {
+    std::cerr << "FastLocate::setGBWT(): The structure does not match the index" << std::endl;
+    return false;
+  }
+  this->index = &source;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  We compute LF() and the text position at the start of the new range in the same pass
+  over the record, starting from the last checkpoint at or before the range. The first
+  occurrence of the successor at or after the start of the range is either at the start
+  of the range, where the text position follows from 'first', or at the start of a run.
+  In the endmarker record, each position is a separate run.
+*/
+
+SearchState
+FastLocate::extend(SearchState state, node_type node, size_type& first) const
+{
+  if(state.empty() || !(this->index->contains(node)))
+  {
+    first = invalid_offset();
+    return SearchState();
+  }
+  CompressedRecord record = this->index->record(state.node);
+  rank_type outrank = record.edgeTo(node);
+  if(outrank >= record.outdegree())
+  {
+    first = invalid_offset();
+    return SearchState();
+  }
+
+  comp_type comp = this->index->toComp(state.node);
+  size_type body_offset = 0, run = 0, run_start = 0, rank = record.offset(outrank);
+  size_type checkpoint = record.findCheckpoint(state.range.first);
+  if(checkpoint < record.checkpoint_count)
+  {
+    body_offset = record.checkpointBody(checkpoint);
+    run = record.checkpointRuns(checkpoint);
+    run_start = record.checkpointOffset(checkpoint);
+    rank += record.checkpointRank(checkpoint, outrank);
+  }
+
+  Run decoder(record.outdegree());
+  // If the first occurrence is at the start of the range and 'first' is not known, the
+  // new toehold is not known either.
+  size_type sp = invalid_offset(), ep = invalid_offset(), next = invalid_offset();
+  bool found = false;
+  while(body_offset < record.data_size)
+  {
+    run_type current = decoder.read(record.body, body_offset);
+    size_type run_end = run_start + current.second;
+    if(run_end > state.range.first)
+    {
+      size_type from = std::max(run_start, state.range.first);
+      if(sp == invalid_offset()) { sp = rank + (current.first == outrank ? from - run_start : 0); }
+      if(current.first == outrank && !found)
+      {
+        found = true;
+        if(comp == 0) { next = this->runSample(comp, run, from) + 1; }
+        else if(run_start > state.range.first) { next = this->runSample(comp, run, run_start) + 1; }
+        else if(first != invalid_offset()) { next = first + 1; }
+      }
+    }
+    if(current.first == outrank) { rank += current.second; }
+    if(run_end > state.range.second)
+    {
+      ep = rank - (current.first == outrank ? run_end - state.range.second - 1 : 0);
+      break;
+    }
+    run_start = run_end; run++;
+  }
+
+  if(sp == invalid_offset() || ep == invalid_offset() || sp >= ep)
+  {
+    first = invalid_offset();
+    return SearchState();
+  }
+  first = next;
+  return SearchState(node, sp, ep - 1);
+}
+
+std::vector<size_type>
+FastLocate::locate(SearchState state, size_type first) const
+{
+  std::vector<size_type> result;
+  this->locate(state, result, first);
+  return result;
+}
+
+void
+FastLocate::locate(SearchState state, std::vector<size_type>& result, size_type first) const
+{
+  result.clear();
+  if(this->index == nullptr || !(this->index->contains(state))) { return; }
+
+  result.reserve(state.size());
+
+  // Each endmarker position is a separate run, and offset 0 is never a phi() key.
+  if(state.node == ENDMARKER)
+  {
+    for(size_type i = state.range.first; i <= state.range.second; i++)
+    {
+      result.push_back(this->seqId(this->runSample(0, 0, i)));
+    }
+    removeDuplicates(result, false);
+    return;
+  }
+
+  // Without a toehold, fall back to the DA samples of the GBWT.
+  if(first == invalid_offset()) { first = this->textPosition(state.node, state.range.first); }
+  if(first == invalid_offset())
+  {
+    result = this->index->locate(state);
+    return;
+  }
+  result.push_back(this->seqId(first));
+  for(size_type i = state.range.first + 1; i <= state.range.second; i++)
+  {
+    first = this->phi(first);
+    result.push_back(this->seqId(first));
+  }
+
+  removeDuplicates(result, false);
+}
+
+size_type
+FastLocate::textPosition(node_type node, size_type i) const
+{
+  comp_type comp = this->index->toComp(node);
+  if(comp == 0) { return this->runSample(comp, 0, i); }
+
+  // Find the run starting at offset i, starting from the last checkpoint at or before i.
+  CompressedRecord record = this->index->record(node);
+  size_type body_offset = 0, run = 0, run_start = 0;
+  size_type checkpoint = record.findCheckpoint(i);
+  if(checkpoint < record.checkpoint_count)
+  {
+    body_offset = record.checkpointBody(checkpoint);
+    run = record.checkpointRuns(checkpoint);
+    run_start = record.checkpointOffset(checkpoint);
+  }
+  Run decoder(record.outdegree());
+  while(run_start < i && body_offset < record.data_size)
+  {
+    run_start += decoder.read(record.body, body_offset).second;
+    run++;
+  }
+
+  if(run_start != i || body_offset >= record.data_size) { return invalid_offset(); }
+  return this->runSample(comp, run, run_start);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwt
@@ -29,11 +29,43 @@ namespace gbwt
 
 //------------------------------------------------------------------------------
 
+std::string
+SamplePolicy::name(std::uint32_t policy)
+{
+  switch(policy)
+  {
+    case INTERVAL:
+      return "interval"; break;
+    case BRANCHING:
+      return "branching"; break;
+    case DEGREE:
+      return "degree"; break;
+    case DENSE:
+      return "dense"; break;
+    case MIXED:
+      return "mixed"; break;
+  }
+  return "unknown";
+}
+
+bool
+SamplePolicy::parse(const std::string& name, policy_type& policy)
+{
+  for(policy_type candidate : { INTERVAL, BRANCHING, DEGREE, DENSE })
+  {
+    if(name == SamplePolicy::name(candidate)) { policy = candidate; return true; }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
 GBWTHeader::GBWTHeader() :
   tag(TAG), version(VERSION),
   sequences(0), size(0),
   offset(0), alphabet_size(0),
-  flags(0)
+  flags(0),
+  sample_policy(SamplePolicy::INTERVAL), sample_interval(SamplePolicy::DEFAULT_INTERVAL)
 {
 }
 
@@ -49,6 +81,8 @@ GBWTHeader::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::stri
   written_bytes += sdsl::write_member(this->offset, out, child, "offset");
   written_bytes += sdsl::write_member(this->alphabet_size, out, child, "alphabet_size");
   written_bytes += sdsl::write_member(this->flags, out, child, "flags");
+  written_bytes += sdsl::write_member(this->sample_policy, out, child, "sample_policy");
+  written_bytes += sdsl::write_member(this->sample_interval, out, child, "sample_interval");
   sdsl::structure_tree::add_size(child, written_bytes);
   return written_bytes;
 }
@@ -63,12 +97,23 @@ GBWTHeader::load(std::istream& in)
   sdsl::read_member(this->offset, in);
   sdsl::read_member(this->alphabet_size, in);
   sdsl::read_member(this->flags, in);
+  if(this->version >= 4)
+  {
+    sdsl::read_member(this->sample_policy, in);
+    sdsl::read_member(this->sample_interval, in);
+  }
+  else
+  {
+    this->sample_policy = SamplePolicy::INTERVAL;
+    this->sample_interval = SamplePolicy::DEFAULT_INTERVAL;
+  }
 }
 
 bool
-GBWTHeader::check(uint32_t expected_version) const
+GBWTHeader::check() const
 {
-  return (this->tag == TAG && this->version == expected_version && this->flags == 0);
+  return (this->tag == TAG && this->version >= MIN_VERSION && this->version <= VERSION && this->flags == 0 &&
+          this->sample_policy <= SamplePolicy::MIXED && this->sample_interval > 0);
 }
 
 bool
@@ -77,6 +122,13 @@ GBWTHeader::checkNew() const
   return (this->tag == TAG && this->version > VERSION);
 }
 
+void
+GBWTHeader::setSampling(SamplePolicy::policy_type policy, size_type interval)
+{
+  this->sample_policy = policy;
+  this->sample_interval = (policy == SamplePolicy::DENSE ? 1 : std::max(interval, size_type(1)));
+}
+
 void
 GBWTHeader::swap(GBWTHeader& another)
 {
@@ -89,6 +141,8 @@ GBWTHeader::swap(GBWTHeader& another)
     std::swap(this->offset, another.offset);
     std::swap(this->alphabet_size, another.alphabet_size);
     std::swap(this->flags, another.flags);
+    std::swap(this->sample_policy, another.sample_policy);
+    std::swap(this->sample_interval, another.sample_interval);
   }
 }
 
@@ -101,14 +155,17 @@ GBWTHeader::operator==(const GBWTHeader& another) const
           this->size == another.size &&
           this->offset == another.offset &&
           this->alphabet_size == another.alphabet_size &&
-          this->flags == another.flags);
+          this->flags == another.flags &&
+          this->sample_policy == another.sample_policy &&
+          this->sample_interval == another.sample_interval);
 }
 
 std::ostream& operator<<(std::ostream& stream, const GBWTHeader& header)
 {
   return stream << "GBWT v" << header.version << ": "
                 << header.sequences << " sequences of total length " << header.size
-                << ", alphabet size " << header.alphabet_size << " with offset " << header.offset;
+                << ", alphabet size " << header.alphabet_size << " with offset " << header.offset
+                << ", " << SamplePolicy::name(header.sample_policy) << " sampling with interval " << header.sample_interval;
 }
 
 //------------------------------------------------------------------------------
@@ -59,6 +59,10 @@ GBWT::swap(GBWT& another)
     this->header.swap(another.header);
     this->bwt.swap(another.bwt);
     this->da_samples.swap(another.da_samples);
+    this->sequence_starts.swap(another.sequence_starts);
+    this->record_sizes.swap(another.record_sizes);
+    this->unary_chains.swap(another.unary_chains);
+    this->prefix_table.swap(another.prefix_table);
   }
 }
 
@@ -77,6 +81,10 @@ GBWT::operator=(GBWT&& source)
     this->header = std::move(source.header);
     this->bwt = std::move(source.bwt);
     this->da_samples = std::move(source.da_samples);
+    this->sequence_starts = std::move(source.sequence_starts);
+    this->record_sizes = std::move(source.record_sizes);
+    this->unary_chains = std::move(source.unary_chains);
+    this->prefix_table = std::move(source.prefix_table);
   }
   return *this;
 }
@@ -90,6 +98,8 @@ GBWT::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string nam
   written_bytes += this->header.serialize(out, child, "header");
   written_bytes += this->bwt.serialize(out, child, "bwt");
   written_bytes += this->da_samples.serialize(out, child, "da_samples");
+  written_bytes += this->sequence_starts.serialize(out, child, "sequence_starts");
+  written_bytes += this->record_sizes.serialize(out, child, "record_sizes");
 
   sdsl::structure_tree::add_size(child, written_bytes);
   return written_bytes;
@@ -106,6 +116,20 @@ GBWT::load(std::istream& in)
 
   this->bwt.load(in);
   this->da_samples.load(in);
+
+  // Older versions do not have the sequence start directory or the record sizes.
+  if(this->header.version >= 2) { this->sequence_starts.load(in); }
+  else if(this->effective() > 0) { this->sequence_starts = SequenceStarts(this->record(ENDMARKER)); }
+  if(this->header.version >= 3) { this->record_sizes.load(in); }
+  else
+  {
+    const RecordArray& records = this->bwt;
+    this->record_sizes = RecordSizes(this->effective(), this->size(), [&records](size_type i) { return records.record(i).size(); });
+  }
+  this->header.version = GBWTHeader::VERSION;
+
+  this->unary_chains = UnaryChains();
+  this->prefix_table = PrefixTable();
 }
 
 void
@@ -114,6 +138,10 @@ GBWT::copy(const GBWT& source)
   this->header = source.header;
   this->bwt = source.bwt;
   this->da_samples = source.da_samples;
+  this->sequence_starts = source.sequence_starts;
+  this->record_sizes = source.record_sizes;
+  this->unary_chains = source.unary_chains;
+  this->prefix_table = source.prefix_table;
 }
 
 //------------------------------------------------------------------------------
@@ -133,11 +161,15 @@ GBWT::GBWT(const std::vector<GBWT>& sources)
     {
       this->header.offset = source.header.offset;
       this->header.alphabet_size = source.header.alphabet_size;
+      this->header.sample_policy = source.header.sample_policy;
+      this->header.sample_interval = source.header.sample_interval;
     }
     else
     {
       this->header.offset = std::min(this->header.offset, source.header.offset);
       this->header.alphabet_size = std::max(this->header.alphabet_size, source.header.alphabet_size);
+      if(source.header.sample_policy != this->header.sample_policy) { this->header.sample_policy = SamplePolicy::MIXED; }
+      this->header.sample_interval = std::max(this->header.sample_interval, source.header.sample_interval);
     }
     valid_sources++;
   }
@@ -188,6 +220,27 @@ GBWT::GBWT(const std::vector<GBWT>& sources)
     }
     this->da_samples = DASamples(sample_sources, origins, record_offsets, sequence_counts);
   }
+
+  // Concatenate the sequence starts.
+  {
+    std::vector<SequenceStarts const*> start_sources(sources.size());
+    for(size_type i = 0; i < sources.size(); i++)
+    {
+      start_sources[i] = &(sources[i].sequence_starts);
+    }
+    this->sequence_starts = SequenceStarts(start_sources);
+  }
+
+  // Interleave the record sizes.
+  {
+    this->record_sizes = RecordSizes(this->effective(), this->size(), [&](comp_type comp) -> size_type
+    {
+      if(comp == ENDMARKER) { return this->sequences(); }
+      size_type origin = origins[comp];
+      if(origin >= sources.size()) { return 0; }
+      return sources[origin].record_sizes.size(comp - record_offsets[origin]);
+    });
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -212,59 +265,104 @@ std::vector<size_type>
 GBWT::locate(SearchState state) const
 {
   std::vector<size_type> result;
-  if(!(this->contains(state))) { return result; }
+  QueryContext context;
+  this->locate(state, result, context);
+  return result;
+}
 
-  // Initialize BWT positions for each offset in the range.
-  std::vector<edge_type> positions(state.size());
-  for(size_type i = state.range.first; i <= state.range.second; i++)
-  {
-    positions[i - state.range.first] = edge_type(state.node, i);
-  }
+//------------------------------------------------------------------------------
+
+std::vector<node_type>
+GBWT::extract(size_type sequence) const
+{
+  std::vector<node_type> result;
+  this->extract(sequence, result);
+  return result;
+}
+
+void
+GBWT::extract(size_type sequence, std::vector<node_type>& result) const
+{
+  if(this->unary_chains.empty()) { gbwt::extract(*this, sequence, result); return; }
+
+  result.clear();
+  if(sequence >= this->sequences()) { return; }
 
-  // Continue with LF() until samples have been found for all sequences.
-  while(!(positions.empty()))
+  edge_type position = this->start(sequence);
+  if(position == invalid_edge()) { return; }
+
+  // No need to check for invalid_edge(), if the initial position is valid.
+  while(position.first != ENDMARKER)
   {
-    size_type tail = 0;
-    node_type curr = invalid_node();
-    CompressedRecord current;
-    sample_type sample;
-    edge_type LF_result;
-    range_type LF_range;
-
-    for(size_type i = 0; i < positions.size(); i++)
+    result.push_back(position.first);
+    size_type start = this->unary_chains.position(this->toComp(position.first));
+    if(start == invalid_offset())
     {
-      if(positions[i].first != curr)              // Node changed.
-      {
-        curr = positions[i].first; current = this->record(curr);
-        sample = this->da_samples.nextSample(this->toComp(curr), positions[i].second);
-        LF_range.first = positions[i].second;
-        LF_result = current.runLF(positions[i].second, LF_range.second);
-      }
-      if(sample.first < positions[i].second)      // Went past the sample.
-      {
-        sample = this->da_samples.nextSample(this->toComp(curr), positions[i].second);
-      }
-      if(sample.first > positions[i].second)      // Not sampled, also valid for invalid_sample().
-      {
-        if(positions[i].second > LF_range.second) // Went past the existing LF() result.
-        {
-          LF_range.first = positions[i].second;
-          LF_result = current.runLF(positions[i].second, LF_range.second);
-        }
-        positions[tail] = edge_type(LF_result.first, LF_result.second + positions[i].second - LF_range.first);
-        tail++;
-      }
-      else                                        // Found a sample.
-      {
-        result.push_back(sample.second);
-      }
+      position = this->LF(position);
+      continue;
     }
-    positions.resize(tail);
-    sequentialSort(positions.begin(), positions.end());
+
+    // Emit the rest of the chain and jump to the exit node.
+    size_type curr = start + 1;
+    while(this->unary_chains.inChain(curr))
+    {
+      result.push_back(this->unary_chains.node(curr));
+      curr++;
+    }
+    position = edge_type(this->unary_chains.node(curr), position.second + this->unary_chains.distance(start, curr));
   }
+}
 
-  removeDuplicates(result, false);
-  return result;
+//------------------------------------------------------------------------------
+
+void
+GBWT::setUnaryChains(bool enabled)
+{
+  if(enabled) { this->unary_chains = UnaryChains(this->bwt, this->header.offset); }
+  else { this->unary_chains = UnaryChains(); }
+}
+
+void
+GBWT::setPrefixTable(size_type length, size_type max_bytes)
+{
+  if(length == 0) { this->prefix_table = PrefixTable(); }
+  else { this->prefix_table = PrefixTable(this->bwt, this->header.offset, length, max_bytes); }
+}
+
+bool
+GBWT::loadPrefixTable(const std::string& filename)
+{
+  PrefixTable table;
+  if(!sdsl::load_from_file(table, filename))
+  {
+    std::cerr << "GBWT::loadPrefixTable(): Cannot load the prefix table from " << filename << std::endl;
+    return false;
+  }
+  if(table.node_offset != this->header.offset || table.alphabet_size != this->sigma() || table.total_length != this->size())
+  {
+    std::cerr << "GBWT::loadPrefixTable(): The prefix table in " << filename << " does not match the index" << std::endl;
+    return false;
+  }
+  this->prefix_table.swap(table);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void
+GBWT::resample(SamplePolicy::policy_type policy, size_type interval)
+{
+  double start = readTimer();
+
+  this->header.setSampling(policy, interval);
+  std::vector<std::pair<edge_type, size_type>> samples = gbwt::resampleSequences(*this, this->header.sample_policy, this->header.sample_interval);
+  this->da_samples = DASamples(samples, this->record_sizes);
+
+  if(Verbosity::level >= Verbosity::BASIC)
+  {
+    double seconds = readTimer() - start;
+    std::cerr << "GBWT::resample(): Sampled " << this->samples() << " positions in " << seconds << " seconds" << std::endl;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -272,9 +370,7 @@ GBWT::locate(SearchState state) const
 CompressedRecord
 GBWT::record(node_type node) const
 {
-  comp_type comp = this->toComp(node);
-  size_type start = this->bwt.start(comp), limit = this->bwt.limit(comp);
-  return CompressedRecord(this->bwt.data, start, limit);
+  return this->bwt.record(this->toComp(node));
 }
 
 //------------------------------------------------------------------------------
@@ -289,8 +385,26 @@ printStatistics(const GBWT& gbwt, const std::string& name)
   printHeader("Effective"); std::cout << gbwt.effective() << std::endl;
   printHeader("Runs"); std::cout << gbwt.runs() << std::endl;
   printHeader("Samples"); std::cout << gbwt.samples() << std::endl;
+  printHeader("Sampling"); std::cout << SamplePolicy::name(gbwt.header.sample_policy) << " (interval " << gbwt.header.sample_interval << ")" << std::endl;
   printHeader("BWT"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.bwt)) << " MB" << std::endl;
+  printHeader("Checkpoints"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.bwt.checkpoint_data)) << " MB (in memory)" << std::endl;
+  if(gbwt.bwt.directory_mode == RecordArray::DIRECTORY_DENSE)
+  {
+    printHeader("Directory"); std::cout << inMegabytes(gbwt.bwt.directory.size() * sizeof(std::uint64_t)) << " MB (in memory)" << std::endl;
+  }
   printHeader("Samples"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.da_samples)) << " MB" << std::endl;
+  printHeader("Sample blocks"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.da_samples.block_starts) + sdsl::size_in_bytes(gbwt.da_samples.offsets) + sdsl::size_in_bytes(gbwt.da_samples.array)) << " MB (in memory)" << std::endl;
+  printHeader("Starts"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.sequence_starts)) << " MB" << std::endl;
+  printHeader("Record sizes"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.record_sizes)) << " MB" << std::endl;
+  if(!(gbwt.unary_chains.empty()))
+  {
+    printHeader("Unary chains"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.unary_chains)) << " MB (in memory)" << std::endl;
+  }
+  if(!(gbwt.prefix_table.empty()))
+  {
+    printHeader("Prefix table"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt.prefix_table)) << " MB ("
+                                           << gbwt.prefix_table.size() << " paths of length " << gbwt.prefix_table.length() << ")" << std::endl;
+  }
   printHeader("Total"); std::cout << inMegabytes(sdsl::size_in_bytes(gbwt)) << " MB" << std::endl;
   std::cout << std::endl;
 }
@@ -27,8 +27,10 @@
 #define GBWT_ALGORITHMS_H
 
 #include <map>
+#include <random>
+#include <set>
 
-#include <gbwt/utils.h>
+#include <gbwt/files.h>
 
 namespace gbwt
 {
@@ -90,6 +92,26 @@ extend(const GBWTType& index, SearchState state, Iterator begin, Iterator end)
   return state;
 }
 
+/*
+  Extends the state with every successor node in a single pass over the record. Returns
+  the non-empty states in the order of the successor nodes.
+*/
+template<class GBWTType>
+std::vector<SearchState>
+extendAll(const GBWTType& index, SearchState state)
+{
+  std::vector<SearchState> result;
+  if(state.empty() || !(index.contains(state.node))) { return result; }
+
+  const auto& record = index.record(state.node);
+  std::vector<range_type> ranges = record.LF(state.range);
+  for(rank_type outrank = 0; outrank < record.outdegree(); outrank++)
+  {
+    if(!(Range::empty(ranges[outrank]))) { result.push_back(SearchState(record.successor(outrank), ranges[outrank])); }
+  }
+  return result;
+}
+
 template<class GBWTType>
 SearchState
 find(const GBWTType& index, node_type node)
@@ -110,6 +132,144 @@ find(const GBWTType& index, Iterator begin, Iterator end)
   return gbwt::extend(index, state, begin, end);
 }
 
+/*
+  Batch search. Each step of a single search depends on the record fetched in the
+  previous step, so the processor mostly waits for cache misses. Here we keep up to
+  FIND_BATCH_WIDTH queries in flight and advance them in a round-robin fashion. Each
+  query alternates between three kinds of rounds:
+
+  - After a step reaches a new node, prefetch the location of the record with
+    index.prefetch(node).
+  - In the next round, find the record and prefetch its body with
+    index.prefetchBody(node).
+  - In the round after that, take the next step.
+
+  The first step uses index.find() for the first findPrefixLength(index) nodes and the
+  other steps use index.extend(), so GBWT uses the prefix table and the unary chains
+  when they are available. The results are the same as from index.find(begin, end)
+  for each query.
+*/
+
+const size_type FIND_BATCH_WIDTH = 16;
+
+// Number of pattern nodes the first step of batch find() covers.
+template<class GBWTType>
+size_type
+findPrefixLength(const GBWTType&)
+{
+  return 1;
+}
+
+template<class GBWTType>
+std::vector<SearchState>
+find(const GBWTType& index, const std::vector<std::vector<node_type>>& queries)
+{
+  std::vector<SearchState> result(queries.size());
+  std::vector<size_type> progress(queries.size(), 0);
+  std::vector<bool> located(queries.size(), false);  // Has prefetchBody() been called?
+  size_type prefix_length = findPrefixLength(index);
+
+  // Start the next query that needs more than one step. Returns false if there are none left.
+  size_type next_query = 0;
+  auto start_query = [&](size_type& query) -> bool
+  {
+    while(next_query < queries.size())
+    {
+      query = next_query; next_query++;
+      const std::vector<node_type>& pattern = queries[query];
+      if(pattern.empty()) { continue; }
+      progress[query] = std::min(pattern.size(), prefix_length);
+      result[query] = index.find(pattern.begin(), pattern.begin() + progress[query]);
+      if(progress[query] < pattern.size() && !(result[query].empty()))
+      {
+        index.prefetch(result[query].node);
+        return true;
+      }
+    }
+    return false;
+  };
+
+  std::vector<size_type> active;
+  active.reserve(FIND_BATCH_WIDTH);
+  size_type query = 0;
+  while(active.size() < FIND_BATCH_WIDTH && start_query(query)) { active.push_back(query); }
+
+  while(!(active.empty()))
+  {
+    for(size_type i = 0; i < active.size(); )
+    {
+      size_type curr = active[i];
+      if(!(located[curr]))
+      {
+        index.prefetchBody(result[curr].node);
+        located[curr] = true; i++;
+        continue;
+      }
+      const std::vector<node_type>& pattern = queries[curr];
+      result[curr] = index.extend(result[curr], pattern.begin() + progress[curr], pattern.begin() + progress[curr] + 1);
+      progress[curr]++; located[curr] = false;
+      if(progress[curr] < pattern.size() && !(result[curr].empty()))
+      {
+        index.prefetch(result[curr].node);
+        i++;
+      }
+      else if(start_query(query)) { active[i] = query; i++; }
+      else { active[i] = active.back(); active.pop_back(); }
+    }
+  }
+
+  return result;
+}
+
+/*
+  Batch search that shares the work on common prefixes. The queries are processed in
+  lexicographic order, and we maintain the search states for the prefixes of the
+  previous query. Each query then starts from the longest prefix it shares with the
+  previous query, and each distinct prefix is extended only once. The results are in
+  the original order, and they are the same as from find(index, begin, end).
+*/
+
+template<class GBWTType>
+std::vector<SearchState>
+findShared(const GBWTType& index, const std::vector<std::vector<node_type>>& queries)
+{
+  std::vector<SearchState> result(queries.size());
+
+  std::vector<size_type> order(queries.size());
+  for(size_type i = 0; i < order.size(); i++) { order[i] = i; }
+  std::sort(order.begin(), order.end(), [&queries](size_type a, size_type b)
+  {
+    return (queries[a] < queries[b]);
+  });
+
+  // states[i] is the search state for the prefix of length i + 1 of the previous query.
+  std::vector<SearchState> states;
+  const std::vector<node_type>* previous = nullptr;
+  for(size_type query : order)
+  {
+    const std::vector<node_type>& pattern = queries[query];
+    if(pattern.empty()) { continue; }
+
+    size_type shared = 0;
+    if(previous != nullptr)
+    {
+      size_type limit = std::min(pattern.size(), previous->size());
+      while(shared < limit && pattern[shared] == (*previous)[shared]) { shared++; }
+    }
+    states.resize(pattern.size());
+    if(shared == 0) { states[0] = gbwt::find(index, pattern[0]); shared = 1; }
+    for(size_type i = shared; i < pattern.size(); i++)
+    {
+      states[i] = (states[i - 1].empty() ? states[i - 1] : gbwt::extend(index, states[i - 1], pattern[i]));
+    }
+
+    result[query] = states[pattern.size() - 1];
+    previous = &pattern;
+  }
+
+  return result;
+}
+
 template<class GBWTType>
 SearchState
 prefix(const GBWTType& index, node_type node)
@@ -128,6 +288,28 @@ prefix(const GBWTType& index, Iterator begin, Iterator end)
 
 //------------------------------------------------------------------------------
 
+/*
+  Scratch space for locate(SearchState). Reusing the same context and the same result
+  vector over many queries avoids heap allocation once the buffers are large enough.
+  A context must not be shared between threads.
+*/
+
+struct QueryContext
+{
+  std::vector<edge_type> positions, successors;
+  std::vector<size_type> offsets;
+
+  // Release the memory.
+  void clear()
+  {
+    std::vector<edge_type>().swap(this->positions);
+    std::vector<edge_type>().swap(this->successors);
+    std::vector<size_type>().swap(this->offsets);
+  }
+};
+
+//------------------------------------------------------------------------------
+
 /*
   If the parameters are invalid, the locate algorithms return invalid_sequence() or an
   empty vector.
@@ -153,22 +335,412 @@ locate(const GBWTType& index, edge_type position)
 
 //------------------------------------------------------------------------------
 
+/*
+  Cost model for choosing the strategy in locate(SearchState). For a range of n positions
+  starting in a record with at most r runs, when the expected distance from a position
+  to the next sample is d LF() steps, the estimated costs in nanoseconds are:
+
+    POINTWISE  n * (r / 2 * run_cost + d * step_cost)
+    RANGE      r * run_cost + d * (range_overhead + n * range_step_cost)
+
+  POINTWISE follows each position separately with locate(edge_type). RANGE processes the
+  entire range with locateRange(), which uses a single batch LF() for all positions in
+  the same record but has a higher fixed cost per step. Ranges longer than chunk_size
+  are always split into chunks that are processed with locateRange() (CHUNKED), which
+  bounds the size of the working set.
+
+  The default parameters are rough estimates. calibrate() measures them on the current
+  host using random queries on the given index. Each LocateStrategy holds its own
+  parameters, so indexes with different characteristics can use separately calibrated
+  instances. A calibrated instance can be shared between threads, as long as it is not
+  modified while queries are running.
+
+  Template parameters:
+    GBWTType  GBWT, DynamicGBWT, or CachedGBWT
+*/
+
+struct LocateStrategy
+{
+  enum strategy_type { AUTOMATIC, POINTWISE, RANGE, CHUNKED };
+
+  double    step_cost, range_step_cost, range_overhead, run_cost;
+  size_type chunk_size;
+
+  constexpr static double DEFAULT_STEP_COST       = 60.0;
+  constexpr static double DEFAULT_RANGE_STEP_COST = 25.0;
+  constexpr static double DEFAULT_RANGE_OVERHEAD  = 35.0;
+  constexpr static double DEFAULT_RUN_COST        = 10.0;
+  const static size_type  DEFAULT_CHUNK_SIZE      = 4096;
+
+  const static size_type CALIBRATION_QUERIES = 500;
+  const static size_type CALIBRATION_RANGE   = 4096; // Maximum range length.
+  const static size_type CALIBRATION_ROUNDS  = 3;
+
+  // Uses the default parameters.
+  LocateStrategy();
+
+  template<class GBWTType>
+  strategy_type choose(const GBWTType& index, SearchState state) const;
+
+  template<class GBWTType>
+  void calibrate(const GBWTType& index, size_type queries = CALIBRATION_QUERIES);
+
+  // Restore the default parameters.
+  void reset();
+
+  static std::string name(strategy_type strategy);
+  void print(std::ostream& out) const;
+};
+
+template<class GBWTType>
+LocateStrategy::strategy_type
+LocateStrategy::choose(const GBWTType& index, SearchState state) const
+{
+  double n = state.size();
+  if(n > this->chunk_size) { return CHUNKED; }
+
+  double d = index.sampleDistance(), r = index.runBound(state.node);
+  double pointwise = n * (r / 2.0 * this->run_cost + d * this->step_cost);
+  double range = r * this->run_cost + d * (this->range_overhead + n * this->range_step_cost);
+  return (pointwise <= range ? POINTWISE : RANGE);
+}
+
+/*
+  Range locate() for a valid search state. Appends the sampled sequence identifiers for
+  all positions in the range to 'result' without sorting them or removing duplicates.
+
+  locateStep() runs one round of it. It appends the identifiers for the sampled positions
+  in context.positions, which must be sorted, and replaces the other positions with their
+  LF() successors in sorted order. The positions are sorted, so the unsampled positions
+  in each record can be processed with a single batch LF().
+
+  The index must provide nextSample(node, i), which returns the first sample at offset
+  >= i in the record or invalid_sample().
+
+  Template parameters:
+    GBWTType  GBWT, DynamicGBWT, or CachedGBWT
+*/
+
+template<class GBWTType>
+void
+locateStep(const GBWTType& index, std::vector<size_type>& result, QueryContext& context)
+{
+  std::vector<edge_type>& positions = context.positions;
+  std::vector<size_type>& offsets = context.offsets;
+  size_type tail = 0;
+  for(size_type i = 0; i < positions.size(); )
+  {
+    node_type curr = positions[i].first;
+    sample_type sample = index.nextSample(curr, positions[i].second);
+    offsets.clear();
+    for(; i < positions.size() && positions[i].first == curr; i++)
+    {
+      if(sample.first < positions[i].second)      // Went past the sample.
+      {
+        sample = index.nextSample(curr, positions[i].second);
+      }
+      if(sample.first > positions[i].second)      // Not sampled, also valid for invalid_sample().
+      {
+        offsets.push_back(positions[i].second);
+      }
+      else                                        // Found a sample.
+      {
+        result.push_back(sample.second);
+      }
+    }
+    index.LF(curr, offsets, context.successors);
+    for(edge_type successor : context.successors) { positions[tail] = successor; tail++; }
+  }
+  positions.resize(tail);
+  sequentialSort(positions.begin(), positions.end());
+}
+
+template<class GBWTType>
+void
+locateRange(const GBWTType& index, SearchState state, std::vector<size_type>& result, QueryContext& context)
+{
+  // Initialize BWT positions for each offset in the range.
+  std::vector<edge_type>& positions = context.positions;
+  positions.resize(state.size());
+  for(size_type i = state.range.first; i <= state.range.second; i++)
+  {
+    positions[i - state.range.first] = edge_type(state.node, i);
+  }
+
+  // Continue with LF() until samples have been found for all sequences.
+  while(!(positions.empty())) { gbwt::locateStep(index, result, context); }
+}
+
+/*
+  The main locate(SearchState) entry point. Replaces the contents of 'result' with the
+  sorted identifiers of the sequences in the range, using 'context' as scratch space.
+  Use strategy AUTOMATIC to let costs.choose() decide. The version without 'costs' uses
+  the default parameters.
+*/
+
+template<class GBWTType>
+void
+locate(const GBWTType& index, SearchState state, std::vector<size_type>& result, QueryContext& context,
+       const LocateStrategy& costs, LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC)
+{
+  result.clear();
+  if(!(index.contains(state))) { return; }
+
+  if(strategy == LocateStrategy::AUTOMATIC) { strategy = costs.choose(index, state); }
+  switch(strategy)
+  {
+  case LocateStrategy::POINTWISE:
+    for(size_type i = state.range.first; i <= state.range.second; i++)
+    {
+      result.push_back(gbwt::locate(index, edge_type(state.node, i)));
+    }
+    break;
+  case LocateStrategy::CHUNKED:
+    {
+      size_type chunk = std::max(costs.chunk_size, size_type(1));
+      for(size_type start = state.range.first; start <= state.range.second; start += chunk)
+      {
+        size_type limit = std::min(start + chunk - 1, state.range.second);
+        index.locateRange(SearchState(state.node, start, limit), result, context);
+      }
+    }
+    break;
+  default:
+    index.locateRange(state, result, context);
+    break;
+  }
+
+  removeDuplicates(result, false);
+}
+
+template<class GBWTType>
+void
+locate(const GBWTType& index, SearchState state, std::vector<size_type>& result, QueryContext& context,
+       LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC)
+{
+  gbwt::locate(index, state, result, context, LocateStrategy(), strategy);
+}
+
+/*
+  Calibration measures the time used by locate() with each strategy for random node
+  ranges (prefixes of up to CALIBRATION_RANGE positions) and for random single
+  positions from the same records, and solves the
+  cost parameters from the totals. The chunk size is chosen from a few candidates using
+  the largest range, if it is long enough. Negative estimates caused by noise are
+  replaced with small positive values.
+*/
+
+template<class GBWTType>
+void
+LocateStrategy::calibrate(const GBWTType& index, size_type queries)
+{
+  this->reset();
+  if(index.empty() || index.effective() <= 1) { return; }
+
+  // Choose random non-empty records, a range, and a random position in the record.
+  std::mt19937_64 rng(0xDEADBEEF);
+  std::vector<SearchState> ranges, positions;
+  size_type attempts = 0;
+  while(ranges.size() < queries && attempts < 4 * queries)
+  {
+    attempts++;
+    node_type node = index.toNode(1 + rng() % (index.effective() - 1));
+    if(!(index.contains(node))) { continue; }
+    size_type node_size = index.nodeSize(node);
+    if(node_size == 0) { continue; }
+    ranges.push_back(SearchState(node, 0, std::min(node_size, CALIBRATION_RANGE) - 1));
+    size_type offset = rng() % node_size;
+    positions.push_back(SearchState(node, offset, offset));
+  }
+  if(ranges.empty()) { return; }
+
+  // The model quantities for the queries.
+  double d = index.sampleDistance(), runs = 0.0, extra = 0.0;
+  for(SearchState state : ranges)
+  {
+    runs += index.runBound(state.node);
+    extra += state.size() - 1;
+  }
+  double q = ranges.size();
+
+  // Minimum time over several rounds, in nanoseconds.
+  std::vector<size_type> result;
+  QueryContext context;
+  auto measure = [&](const std::vector<SearchState>& states, strategy_type strategy) -> double
+  {
+    double best = 0.0;
+    for(size_type round = 0; round < CALIBRATION_ROUNDS; round++)
+    {
+      double start = readTimer();
+      for(SearchState state : states) { gbwt::locate(index, state, result, context, *this, strategy); }
+      double seconds = readTimer() - start;
+      if(round == 0 || seconds < best) { best = seconds; }
+    }
+    return best * 1e9;
+  };
+
+  // Record decoding: time per run from LF() on the single positions.
+  volatile size_type sink = 0;
+  {
+    double best = 0.0;
+    for(size_type round = 0; round < CALIBRATION_ROUNDS; round++)
+    {
+      double start = readTimer();
+      size_type checksum = 0;
+      for(SearchState state : positions) { checksum += index.LF(state.node, state.range.first).second; }
+      double seconds = readTimer() - start;
+      sink = checksum;
+      if(round == 0 || seconds < best) { best = seconds; }
+    }
+    this->run_cost = std::max(best * 1e9 / (runs / 2.0 + q), 0.1);
+  }
+  (void)sink;
+
+  // Pointwise locate() for single positions.
+  double pointwise = measure(positions, POINTWISE);
+  this->step_cost = std::max((pointwise - runs / 2.0 * this->run_cost) / (q * d), 1.0);
+
+  // Range locate() for single positions and for the ranges.
+  double single = measure(positions, RANGE), full = measure(ranges, RANGE);
+  if(extra > 0.0) { this->range_step_cost = std::max((full - single) / (extra * d), 0.1 * this->step_cost); }
+  this->range_overhead = std::max((single - runs * this->run_cost) / (q * d) - this->range_step_cost, 0.0);
+
+  // Chunk size from the largest range.
+  SearchState largest = ranges.front();
+  for(SearchState state : ranges)
+  {
+    if(state.size() > largest.size()) { largest = state; }
+  }
+  const size_type MIN_CHUNK = 256;
+  if(largest.size() >= 2 * MIN_CHUNK)
+  {
+    std::vector<SearchState> sample(1, largest);
+    double best = 0.0;
+    size_type best_chunk = this->chunk_size;
+    for(size_type candidate = MIN_CHUNK; candidate <= largest.size(); candidate *= 4)
+    {
+      this->chunk_size = candidate;
+      double time = measure(sample, CHUNKED);
+      if(candidate == MIN_CHUNK || time < best) { best = time; best_chunk = candidate; }
+    }
+    this->chunk_size = best_chunk;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Incremental locate(SearchState). The range is processed in chunks of at most
+  'chunk_size' offsets with gbwt::locateStep(), and the identifiers found in each round of
+  LF() steps become available before the next round starts. Hence the caller can stop
+  after the first k results without locating the rest of the range, and the working
+  space is bounded by the chunk size. Unlike locate(), the results are not sorted, and a
+  sequence visiting the node several times is reported once for each visit. An invalid
+  search state produces no results.
+
+  Usage:
+
+    for(LocateIterator<GBWT> iter(index, state); !(iter.end()); ++iter) { ... *iter ... }
+
+  Template parameters:
+    GBWTType  GBWT, DynamicGBWT, or CachedGBWT
+*/
+
+template<class GBWTType>
+struct LocateIterator
+{
+  LocateIterator(const GBWTType& source, SearchState state, size_type chunk_size = LocateStrategy::DEFAULT_CHUNK_SIZE) :
+    index(&source), node(state.node),
+    next_offset(0), limit(0), chunk(std::max(chunk_size, size_type(1))),
+    pos(0)
+  {
+    if(source.contains(state))
+    {
+      this->next_offset = state.range.first; this->limit = state.range.second + 1;
+    }
+    this->fill();
+  }
+
+  bool end() const { return (this->pos >= this->buffer.size()); }
+  void operator++() { this->pos++; if(this->end()) { this->fill(); } }
+
+  size_type operator*() const { return this->buffer[this->pos]; }
+
+  // Number of identifiers that have not been returned yet.
+  size_type remaining() const
+  {
+    return (this->limit - this->next_offset) + this->context.positions.size() + (this->buffer.size() - this->pos);
+  }
+
+  const GBWTType*        index;
+  node_type              node;
+  size_type              next_offset, limit, chunk;
+
+  QueryContext           context;
+  std::vector<size_type> buffer;
+  size_type              pos;
+
+private:
+  // Run LF() rounds until some identifiers are found or the range has been processed.
+  void fill()
+  {
+    this->buffer.clear(); this->pos = 0;
+    while(this->buffer.empty())
+    {
+      if(this->context.positions.empty())
+      {
+        if(this->next_offset >= this->limit) { return; }
+        size_type chunk_limit = std::min(this->next_offset + this->chunk, this->limit);
+        for(size_type i = this->next_offset; i < chunk_limit; i++)
+        {
+          this->context.positions.push_back(edge_type(this->node, i));
+        }
+        this->next_offset = chunk_limit;
+      }
+      gbwt::locateStep(*(this->index), this->buffer, this->context);
+    }
+  }
+};
+
+/*
+  Returns the identifiers of the first k distinct sequences found in the range in the
+  order they were found. Because LocateIterator reports a sequence once for each visit,
+  this may have to process more than k offsets. See LocateIterator.
+*/
+
+template<class GBWTType>
+std::vector<size_type>
+locateFirst(const GBWTType& index, SearchState state, size_type k)
+{
+  std::vector<size_type> result;
+  std::set<size_type> found;
+  for(LocateIterator<GBWTType> iter(index, state); result.size() < k && !(iter.end()); ++iter)
+  {
+    if(found.insert(*iter).second) { result.push_back(*iter); }
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
 /*
   If the parameters are invalid, the extraction algorithms return an empty container.
+  The versions with an output parameter replace its contents, allowing the caller to
+  reuse the same vector over many queries.
 
   Template parameters:
     GBWTType  GBWT or DynamicGBWT
 */
 
 template<class GBWTType>
-std::vector<node_type>
-extract(const GBWTType& index, size_type sequence)
+void
+extract(const GBWTType& index, size_type sequence, std::vector<node_type>& result)
 {
-  std::vector<node_type> result;
-  if(sequence >= index.sequences()) { return result; }
+  result.clear();
+  if(sequence >= index.sequences()) { return; }
 
   edge_type position = index.start(sequence);
-  if(position == invalid_edge()) { return result; }
+  if(position == invalid_edge()) { return; }
 
   // No need to check for invalid_edge(), if the initial position is valid.
   while(position.first != ENDMARKER)
@@ -176,6 +748,125 @@ extract(const GBWTType& index, size_type sequence)
     result.push_back(position.first);
     position = index.LF(position);
   }
+}
+
+template<class GBWTType>
+std::vector<node_type>
+extract(const GBWTType& index, size_type sequence)
+{
+  std::vector<node_type> result;
+  gbwt::extract(index, sequence, result);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Parallel batch queries. The queries are distributed over the OpenMP threads (see
+  omp_set_num_threads()) with dynamic scheduling, as locate() ranges and sequence
+  lengths are often highly skewed. The output vector is resized to the number of
+  queries, and each thread writes its results directly to the corresponding slots,
+  reusing the existing inner vectors and a thread-local QueryContext. The results are
+  the same as from the corresponding single-query member functions.
+
+  Template parameters:
+    GBWTType  GBWT or DynamicGBWT
+*/
+
+const size_type FIND_ALL_CHUNK = 64; // find() queries are cheap and roughly uniform.
+
+template<class GBWTType>
+void
+findAll(const GBWTType& index, const std::vector<std::vector<node_type>>& queries, std::vector<SearchState>& results)
+{
+  results.resize(queries.size());
+  #pragma omp parallel for schedule(dynamic, FIND_ALL_CHUNK)
+  for(size_type i = 0; i < queries.size(); i++)
+  {
+    results[i] = index.find(queries[i].begin(), queries[i].end());
+  }
+}
+
+template<class GBWTType>
+void
+locateAll(const GBWTType& index, const std::vector<SearchState>& queries, std::vector<std::vector<size_type>>& results)
+{
+  results.resize(queries.size());
+  #pragma omp parallel
+  {
+    QueryContext context;
+    #pragma omp for schedule(dynamic, 1)
+    for(size_type i = 0; i < queries.size(); i++)
+    {
+      index.locate(queries[i], results[i], context);
+    }
+  }
+}
+
+template<class GBWTType>
+void
+extractAll(const GBWTType& index, const std::vector<size_type>& sequences, std::vector<std::vector<node_type>>& results)
+{
+  results.resize(sequences.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_type i = 0; i < sequences.size(); i++)
+  {
+    index.extract(sequences[i], results[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Resampling. Walks all sequences in parallel with LF() from their starts and returns the
+  positions selected by the sampling policy (see SamplePolicy) as ((comp, offset), sequence
+  id) pairs sorted by position. Positions are numbered as during construction, with the
+  position in the endmarker record as iteration 1. The outdegrees and the record offsets
+  are those of the final GBWT, which may differ from those during construction.
+
+  Template parameters:
+    GBWTType  GBWT or DynamicGBWT
+*/
+
+template<class GBWTType>
+std::vector<std::pair<edge_type, size_type>>
+resampleSequences(const GBWTType& index, std::uint32_t policy, size_type interval)
+{
+  std::vector<std::pair<edge_type, size_type>> result;
+  if(index.sequences() == 0) { return result; }
+
+  std::vector<range_type> blocks = Range::partition(range_type(0, index.sequences() - 1), 4 * omp_get_max_threads());
+  std::vector<std::vector<std::pair<edge_type, size_type>>> block_samples(blocks.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_type block = 0; block < blocks.size(); block++)
+  {
+    for(size_type sequence = blocks[block].first; sequence <= blocks[block].second; sequence++)
+    {
+      edge_type position(ENDMARKER, sequence);
+      for(size_type iteration = 1; ; iteration++)
+      {
+        const auto& record = index.record(position.first);
+        edge_type next = record.LF(position.second);
+        if(next.first == ENDMARKER || SamplePolicy::sample(policy, interval, iteration, position.second, record.outdegree()))
+        {
+          block_samples[block].push_back(std::make_pair(edge_type(index.toComp(position.first), position.second), sequence));
+        }
+        if(next.first == ENDMARKER) { break; }
+        position = next;
+      }
+    }
+  }
+
+  size_type total = 0;
+  for(const std::vector<std::pair<edge_type, size_type>>& samples : block_samples) { total += samples.size(); }
+  result.reserve(total);
+  for(std::vector<std::pair<edge_type, size_type>>& samples : block_samples)
+  {
+    result.insert(result.end(), samples.begin(), samples.end());
+    sdsl::util::clear(samples);
+  }
+  parallelQuickSort(result.begin(), result.end());
+
   return result;
 }
 
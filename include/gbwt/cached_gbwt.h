@@ -0,0 +1,442 @@
+/*
+  Copyright (c) 2017 Jouni Siren
+  Copyright (c) 2017 Genome Research Ltd.
+
+  Author: Jouni Siren <jouni.siren@iki.fi>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef GBWT_CACHED_GBWT_H
+#define GBWT_CACHED_GBWT_H
+
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include <gbwt/gbwt.h>
+
+namespace gbwt
+{
+
+/*
+  cached_gbwt.h: Caching query interfaces for the compressed GBWT.
+*/
+
+//------------------------------------------------------------------------------
+
+/*
+  A decoded record in the cache. The outgoing edges are always decoded. If the body has
+  at most CachedGBWT::MAX_DECODED_RUNS runs, the runs are also decoded, and the queries
+  use them instead of the compressed body.
+*/
+
+struct CachedRecord
+{
+  typedef gbwt::size_type size_type;
+
+  node_type             node;     // invalid_node() for an empty slot.
+  size_type             record_size;
+  bool                  decoded;
+  CompressedRecord      compressed;
+  std::vector<run_type> runs;
+
+  CachedRecord() : node(invalid_node()), record_size(0), decoded(false) {}
+
+  size_type size() const { return this->record_size; }
+  bool empty() const { return (this->size() == 0); }
+  size_type outdegree() const { return this->compressed.outdegree(); }
+
+  // The queries have the same semantics as in CompressedRecord.
+  edge_type LF(size_type i) const;
+  size_type LF(size_type i, node_type to) const;
+  range_type LF(range_type range, node_type to) const;
+  std::vector<edge_type> LF(const std::vector<size_type>& positions) const;
+  void LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const;
+  std::vector<range_type> LF(const std::vector<range_type>& ranges, node_type to) const;
+  std::vector<range_type> LF(range_type range) const;
+  node_type operator[](size_type i) const;
+
+  bool hasEdge(node_type to) const { return this->compressed.hasEdge(to); }
+  rank_type edgeTo(node_type to) const { return this->compressed.edgeTo(to); }
+  node_type successor(rank_type outrank) const { return this->compressed.successor(outrank); }
+  size_type offset(rank_type outrank) const { return this->compressed.offset(outrank); }
+
+private:
+  // Number of occurrences of 'outrank' in the decoded body before offset i.
+  size_type rank(size_type i, rank_type outrank) const;
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  A query handle over a compressed GBWT with a bounded cache of decoded records. The
+  handle provides the query interface of GBWT, so it can be used with the templates in
+  algorithms.h. Looking up a cached record avoids the select queries and the decoding
+  of the outgoing edges, and queries on short records use the decoded runs.
+
+  The cache is direct-mapped by node identifier, which works well when the queries
+  revisit the nodes in a small region of the graph. The handle does not modify the
+  GBWT, but the queries update the cache. Each thread should therefore use its own
+  handle. Any number of handles can share the same GBWT.
+
+  The reference returned by record() remains valid until the next query.
+*/
+
+class CachedGBWT
+{
+public:
+  typedef CompressedRecord::size_type size_type;
+
+  const static size_type DEFAULT_CAPACITY = 4096; // Records, rounded up to a power of two.
+  const static size_type MAX_DECODED_RUNS = 16;
+
+//------------------------------------------------------------------------------
+
+  explicit CachedGBWT(const GBWT& graph, size_type capacity = DEFAULT_CAPACITY);
+
+  void swap(CachedGBWT& another);
+
+  // Empty the cache and reset the statistics.
+  void clearCache();
+
+//------------------------------------------------------------------------------
+
+  /*
+    Cache statistics.
+  */
+
+  size_type capacity() const { return this->cache.size(); }
+  size_type hits() const { return this->cache_hits; }
+  size_type misses() const { return this->cache_misses; }
+  double hitRate() const
+  {
+    size_type total = this->hits() + this->misses();
+    return (total > 0 ? this->hits() / static_cast<double>(total) : 0.0);
+  }
+
+//------------------------------------------------------------------------------
+
+  /*
+    Low-level interface: Statistics.
+  */
+
+  size_type size() const { return this->index->size(); }
+  bool empty() const { return this->index->empty(); }
+  size_type sequences() const { return this->index->sequences(); }
+  size_type sigma() const { return this->index->sigma(); }
+  size_type effective() const { return this->index->effective(); }
+
+//------------------------------------------------------------------------------
+
+  /*
+    High-level interface. See GBWT.
+  */
+
+  template<class Iterator>
+  SearchState find(Iterator begin, Iterator end) const { return gbwt::find(*this, begin, end); }
+
+  SearchState prefix(node_type node) const { return gbwt::prefix(*this, node); }
+
+  template<class Iterator>
+  SearchState prefix(Iterator begin, Iterator end) const { return gbwt::prefix(*this, begin, end); }
+
+  SearchState extend(SearchState state, node_type node) const { return gbwt::extend(*this, state, node); }
+
+  std::vector<SearchState> extendAll(SearchState state) const { return gbwt::extendAll(*this, state); }
+
+  template<class Iterator>
+  SearchState extend(SearchState state, Iterator begin, Iterator end) const { return gbwt::extend(*this, state, begin, end); }
+
+  size_type locate(node_type node, size_type i) const { return gbwt::locate(*this, range_type(node, i)); }
+  size_type locate(edge_type position) const { return gbwt::locate(*this, position); }
+
+  std::vector<size_type> locate(node_type node, range_type range) const { return this->locate(SearchState(node, range)); }
+  std::vector<size_type> locate(SearchState state) const;
+
+  // Replaces the contents of 'result' and uses 'context' as scratch space. See gbwt::locate().
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, strategy);
+  }
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context, const LocateStrategy& costs,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, costs, strategy);
+  }
+
+  std::vector<node_type> extract(size_type sequence) const { return gbwt::extract(*this, sequence); }
+  void extract(size_type sequence, std::vector<node_type>& result) const { gbwt::extract(*this, sequence, result); }
+
+//------------------------------------------------------------------------------
+
+  /*
+    Low-level interface: Nodes. See GBWT.
+  */
+
+  bool contains(node_type node) const { return this->index->contains(node); }
+
+  bool contains(edge_type position) const
+  {
+    return (this->contains(position.first) && position.second < this->nodeSize(position.first));
+  }
+
+  bool contains(SearchState state) const
+  {
+    return (this->contains(state.node) && !(state.empty()) && state.range.second < this->nodeSize(state.node));
+  }
+
+  bool hasEdge(node_type from, node_type to) const
+  {
+    return (this->contains(from) && this->record(from).hasEdge(to));
+  }
+
+  comp_type toComp(node_type node) const { return this->index->toComp(node); }
+  node_type toNode(comp_type comp) const { return this->index->toNode(comp); }
+
+  size_type nodeSize(node_type node) const { return this->record(node).size(); }
+
+  const CachedRecord& record(node_type node) const
+  {
+    CachedRecord& entry = this->cache[this->toComp(node) & this->mask];
+    if(entry.node == node) { this->cache_hits++; }
+    else { this->cache_misses++; this->decode(node, entry); }
+    return entry;
+  }
+
+  /*
+    Two-stage prefetch for a later query. prefetch() prefetches the cache slot and the
+    location of the record in the index. prefetchBody() checks the slot, which should
+    then hit the cache, and prefetches either the cached record or the compressed one.
+  */
+  void prefetch(node_type node) const
+  {
+    prefetchRead(&(this->cache[this->toComp(node) & this->mask]));
+    this->index->prefetch(node);
+  }
+  void prefetchBody(node_type node) const
+  {
+    const CachedRecord& entry = this->cache[this->toComp(node) & this->mask];
+    if(entry.node != node) { this->index->prefetchBody(node); }
+    else if(entry.decoded)
+    {
+      prefetchRange(entry.runs.data(), std::min(static_cast<size_type>(entry.runs.size() * sizeof(run_type)), RecordArray::PREFETCH_BYTES));
+    }
+    else { prefetchRange(entry.compressed.body, std::min(entry.compressed.data_size, RecordArray::PREFETCH_BYTES)); }
+  }
+
+//------------------------------------------------------------------------------
+
+  /*
+    Low-level interface: Navigation and searching. See GBWT.
+  */
+
+  edge_type LF(node_type from, size_type i) const
+  {
+    return this->record(from).LF(i);
+  }
+
+  edge_type LF(edge_type position) const
+  {
+    return this->record(position.first).LF(position.second);
+  }
+
+  size_type LF(node_type from, size_type i, node_type to) const
+  {
+    return this->record(from).LF(i, to);
+  }
+
+  size_type LF(edge_type position, node_type to) const
+  {
+    return this->record(position.first).LF(position.second, to);
+  }
+
+  range_type LF(node_type from, range_type range, node_type to) const
+  {
+    return this->record(from).LF(range, to);
+  }
+
+  range_type LF(SearchState state, node_type to) const
+  {
+    return this->record(state.node).LF(state.range, to);
+  }
+
+  std::vector<edge_type> LF(node_type from, const std::vector<size_type>& positions) const
+  {
+    return this->record(from).LF(positions);
+  }
+
+  void LF(node_type from, const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+  {
+    this->record(from).LF(positions, result);
+  }
+
+  std::vector<range_type> LF(node_type from, const std::vector<range_type>& ranges, node_type to) const
+  {
+    return this->record(from).LF(ranges, to);
+  }
+
+//------------------------------------------------------------------------------
+
+  /*
+    Low-level interface: Sequences. See GBWT.
+  */
+
+  edge_type start(size_type sequence) const { return this->index->start(sequence); }
+
+  size_type tryLocate(node_type node, size_type i) const { return this->index->tryLocate(node, i); }
+  size_type tryLocate(edge_type position) const { return this->index->tryLocate(position); }
+
+  sample_type nextSample(node_type node, size_type i) const { return this->index->nextSample(node, i); }
+
+  // Range locate() for a valid search state. See gbwt::locateRange().
+  void locateRange(SearchState state, std::vector<size_type>& result, QueryContext& context) const
+  {
+    gbwt::locateRange(*this, state, result, context);
+  }
+
+  double sampleDistance() const { return this->index->sampleDistance(); }
+  size_type runBound(node_type node) const { return this->index->runBound(node); }
+
+//------------------------------------------------------------------------------
+
+  const GBWT* index;
+
+private:
+  mutable std::vector<CachedRecord> cache;
+  size_type                         mask;
+  mutable size_type                 cache_hits, cache_misses;
+
+  void decode(node_type node, CachedRecord& entry) const;
+}; // class CachedGBWT
+
+//------------------------------------------------------------------------------
+
+/*
+  A size-bounded cache of query results shared between threads. The cache memoizes
+  find() states, locate() results, and extract() outputs, using the query content as
+  the key. Cache misses are computed outside the lock, so concurrent queries only wait
+  for the bookkeeping.
+
+  Eviction follows the GreedyDual-Size policy. Each entry has priority L + cost / bytes,
+  where L is the priority of the last evicted entry and the cost is an estimate of the
+  work needed to recompute the result:
+
+    find     pattern length
+    locate   LOCATE_COST * range length (LF steps to reach the samples)
+    extract  sequence length
+
+  Hence results that are expensive relative to their size, such as large locate()
+  queries, stay in the cache longer. Results larger than the capacity are not cached.
+*/
+
+class ResultCache
+{
+public:
+  typedef CompressedRecord::size_type size_type;
+
+  const static size_type DEFAULT_CAPACITY = 64 * MEGABYTE;
+  const static size_type LOCATE_COST = 64;
+  const static size_type ENTRY_OVERHEAD = 96;  // Bytes per entry for the bookkeeping.
+
+//------------------------------------------------------------------------------
+
+  explicit ResultCache(const GBWT& graph, size_type capacity_bytes = DEFAULT_CAPACITY);
+
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator= (const ResultCache&) = delete;
+
+  // Empty the cache and reset the statistics.
+  void clear();
+
+//------------------------------------------------------------------------------
+
+  /*
+    Cached queries. The results are the same as from the corresponding GBWT queries.
+  */
+
+  SearchState find(const std::vector<node_type>& pattern);
+  std::vector<size_type> locate(SearchState state);
+  std::vector<node_type> extract(size_type sequence);
+
+//------------------------------------------------------------------------------
+
+  /*
+    Statistics.
+  */
+
+  size_type capacity() const { return this->max_bytes; }
+  size_type size() const;   // Entries.
+  size_type bytes() const;  // Estimated memory usage.
+  size_type hits() const;
+  size_type misses() const;
+  size_type evictions() const;
+  double hitRate() const;
+
+//------------------------------------------------------------------------------
+
+  const GBWT* index;
+
+private:
+  typedef std::vector<size_type> key_type;
+
+  struct KeyHash
+  {
+    size_type operator()(const key_type& key) const
+    {
+      size_type result = FNV_OFFSET_BASIS;
+      for(size_type value : key) { result = fnv1a_hash(value, result); }
+      return result;
+    }
+  };
+
+  struct Entry
+  {
+    SearchState            state;
+    std::vector<size_type> values;
+    size_type              bytes;
+    double                 priority, weight;  // weight = cost / bytes
+  };
+
+  enum QueryType { QUERY_FIND = 0, QUERY_LOCATE = 1, QUERY_EXTRACT = 2 };
+
+  typedef std::unordered_map<key_type, Entry, KeyHash> map_type;
+
+  typedef std::set<std::pair<double, const key_type*>> queue_type;
+
+  mutable std::mutex cache_mutex;
+  map_type           entries;
+  queue_type         queue;       // (priority, key) for all entries.
+  size_type          max_bytes, used_bytes;
+  double             inflation;   // L in GreedyDual-Size.
+  size_type          cache_hits, cache_misses, cache_evictions;
+
+  // Returns true and sets 'result' if the key is in the cache. Updates the statistics.
+  bool lookup(const key_type& key, Entry& result);
+
+  // Insert the entry unless the key is already in the cache.
+  void insert(const key_type& key, Entry& entry, size_type cost);
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwt
+
+#endif // GBWT_CACHED_GBWT_H
@@ -48,7 +48,7 @@ public:
 
   const static size_type INSERT_BATCH_SIZE = 100 * MILLION; // Nodes.
   const static size_type MERGE_BATCH_SIZE = 2000;           // Sequences.
-  const static size_type SAMPLE_INTERVAL = 1024;            // Positions in a sequence.
+  const static size_type SAMPLE_INTERVAL = SamplePolicy::DEFAULT_INTERVAL;
 
 //------------------------------------------------------------------------------
 
@@ -68,6 +68,16 @@ public:
 
 //------------------------------------------------------------------------------
 
+  /*
+    Set the sampling policy used for the new sequences; see SamplePolicy. The policy can
+    only be changed while the GBWT is empty. Returns false and prints an error message if
+    the GBWT already uses a different policy.
+  */
+  bool setSampling(SamplePolicy::policy_type policy, size_type interval = SAMPLE_INTERVAL);
+
+  // Rebuild the samples under a new sampling policy. See GBWT::resample().
+  void resample(SamplePolicy::policy_type policy, size_type interval = SAMPLE_INTERVAL);
+
   /*
     Insert one or more sequences to the GBWT. The text must be a concatenation of sequences,
     each of which ends with an endmarker (0). The new sequences receive identifiers starting
@@ -86,7 +96,7 @@ public:
 
   /*
     Insert the sequences from the other GBWT into this. Use batch size 0 to insert all
-    sequences at once.
+    sequences at once. The samples follow the sampling policy of this GBWT.
   */
   void merge(const GBWT& source, size_type batch_size = MERGE_BATCH_SIZE);
 
@@ -112,13 +122,20 @@ public:
     must be InputIterators. On error or failed search, the return values will be the
     following:
 
-    find     empty search state
-    prefix   empty search state
-    extend   empty search state
-    locate   invalid_sequence() or empty vector
-    extract  empty vector
+    find       empty search state
+    prefix     empty search state
+    extend     empty search state
+    extendAll  empty vector
+    locate     invalid_sequence() or empty vector
+    extract    empty vector
   */
 
+  // Batch search that keeps several queries in flight. See gbwt::find().
+  std::vector<SearchState> find(const std::vector<std::vector<node_type>>& queries) const { return gbwt::find(*this, queries); }
+
+  // Batch search that extends each distinct prefix only once. See gbwt::findShared().
+  std::vector<SearchState> findShared(const std::vector<std::vector<node_type>>& queries) const { return gbwt::findShared(*this, queries); }
+
   template<class Iterator>
   SearchState find(Iterator begin, Iterator end) const { return gbwt::find(*this, begin, end); }
 
@@ -129,6 +146,9 @@ public:
 
   SearchState extend(SearchState state, node_type node) const { return gbwt::extend(*this, state, node); }
 
+  // Returns the non-empty extensions to all successor nodes.
+  std::vector<SearchState> extendAll(SearchState state) const { return gbwt::extendAll(*this, state); }
+
   template<class Iterator>
   SearchState extend(SearchState state, Iterator begin, Iterator end) const { return gbwt::extend(*this, state, begin, end); }
 
@@ -138,7 +158,41 @@ public:
   std::vector<size_type> locate(node_type node, range_type range) const { return this->locate(SearchState(node, range)); }
   std::vector<size_type> locate(SearchState state) const;
 
+  // Replaces the contents of 'result' and uses 'context' as scratch space. See gbwt::locate().
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, strategy);
+  }
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context, const LocateStrategy& costs,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, costs, strategy);
+  }
+
+  // Incremental locate() that can stop early. See LocateIterator.
+  LocateIterator<DynamicGBWT> locateIterator(SearchState state, size_type chunk_size = LocateStrategy::DEFAULT_CHUNK_SIZE) const
+  {
+    return LocateIterator<DynamicGBWT>(*this, state, chunk_size);
+  }
+  std::vector<size_type> locateFirst(SearchState state, size_type k) const { return gbwt::locateFirst(*this, state, k); }
+
   std::vector<node_type> extract(size_type sequence) const { return gbwt::extract(*this, sequence); }
+  void extract(size_type sequence, std::vector<node_type>& result) const { gbwt::extract(*this, sequence, result); }
+
+  // Parallel batch queries. See gbwt::findAll().
+  void findAll(const std::vector<std::vector<node_type>>& queries, std::vector<SearchState>& results) const
+  {
+    gbwt::findAll(*this, queries, results);
+  }
+  void locateAll(const std::vector<SearchState>& queries, std::vector<std::vector<size_type>>& results) const
+  {
+    gbwt::locateAll(*this, queries, results);
+  }
+  void extractAll(const std::vector<size_type>& sequences, std::vector<std::vector<node_type>>& results) const
+  {
+    gbwt::extractAll(*this, sequences, results);
+  }
 
 //------------------------------------------------------------------------------
 
@@ -182,6 +236,19 @@ public:
     return this->bwt[this->toComp(node)];
   }
 
+  /*
+    Two-stage prefetch for a later query. prefetch() prefetches the record header
+    without reading it. prefetchBody() reads the header, which should then hit the
+    cache, and prefetches the outgoing edges and the start of the body.
+  */
+  void prefetch(node_type node) const { prefetchRead(&(this->record(node))); }
+  void prefetchBody(node_type node) const
+  {
+    const DynamicRecord& record = this->record(node);
+    prefetchRead(record.outgoing.data());
+    prefetchRange(record.body.data(), std::min(static_cast<size_type>(record.body.size() * sizeof(run_type)), RecordArray::PREFETCH_BYTES));
+  }
+
 //------------------------------------------------------------------------------
 
   /*
@@ -225,6 +292,24 @@ public:
     return this->record(state.node).LF(state.range, to);
   }
 
+  // Batch LF() for positions in non-decreasing order. On error: invalid_edge() for the position.
+  std::vector<edge_type> LF(node_type from, const std::vector<size_type>& positions) const
+  {
+    return this->record(from).LF(positions);
+  }
+
+  // As above, but replaces the contents of 'result'.
+  void LF(node_type from, const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+  {
+    this->record(from).LF(positions, result);
+  }
+
+  // Batch LF() for sorted non-overlapping ranges. On error: Range::empty_range() for the range.
+  std::vector<range_type> LF(node_type from, const std::vector<range_type>& ranges, node_type to) const
+  {
+    return this->record(from).LF(ranges, to);
+  }
+
 //------------------------------------------------------------------------------
 
   /*
@@ -233,16 +318,36 @@ public:
   */
 
   // Starting position of the sequence or invalid_edge() if something fails.
-  edge_type start(size_type sequence) const { return this->LF(ENDMARKER, sequence); }
+  edge_type start(size_type sequence) const { return this->sequence_starts.start(sequence); }
 
   // Returns the sampled document identifier or invalid_sequence() if there is no sample.
   size_type tryLocate(node_type node, size_type i) const;
   size_type tryLocate(edge_type position) const { return this->tryLocate(position.first, position.second); }
 
+  // Returns the first sample at offset >= i in the record or invalid_sample() if there is none.
+  sample_type nextSample(node_type node, size_type i) const;
+
+  // Range locate() for a valid search state. See gbwt::locateRange().
+  void locateRange(SearchState state, std::vector<size_type>& result, QueryContext& context) const
+  {
+    gbwt::locateRange(*this, state, result, context);
+  }
+
+  // Expected number of LF() steps from a position to the next sample. Based on the
+  // sample interval, as counting the samples is expensive.
+  double sampleDistance() const
+  {
+    double length = static_cast<double>(this->size()) / std::max(this->sequences(), size_type(1));
+    return (std::min(length, static_cast<double>(this->header.sample_interval)) + 1.0) / 2.0;
+  }
+
+  size_type runBound(node_type node) const { return this->record(node).runs(); }
+
 //------------------------------------------------------------------------------
 
   GBWTHeader                 header;
   std::vector<DynamicRecord> bwt;
+  SequenceStarts             sequence_starts;
 
 //------------------------------------------------------------------------------
 
@@ -256,6 +361,9 @@ private:
     Sort the outgoing edges and change the outranks in the runs accordingly.
     While the GBWT works with any edge order, serialization requires sorted edges,
     as the identifiers of destination nodes are gap-encoded.
+
+    Because recode() is the last step of every insertion, it also rebuilds the
+    sequence start directory.
   */
   void recode();
 
@@ -267,6 +375,13 @@ private:
 
 void printStatistics(const DynamicGBWT& gbwt, const std::string& name);
 
+/*
+  Follow each sequence with LF() in both indexes and check that the sampled positions are
+  the same and that each sample has the correct sequence identifier. Prints at most
+  'max_errors' error messages and returns the number of errors.
+*/
+size_type verifySamples(const GBWT& compressed_index, const DynamicGBWT& dynamic_index, size_type max_errors);
+
 //------------------------------------------------------------------------------
 
 class GBWTBuilder
@@ -0,0 +1,198 @@
+/*
+  Copyright (c) 2017 Jouni Siren
+  Copyright (c) 2017 Genome Research Ltd.
+
+  Author: Jouni Siren <jouni.siren@iki.fi>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#ifndef GBWT_FAST_LOCATE_H
+#define GBWT_FAST_LOCATE_H
+
+#include <gbwt/gbwt.h>
+
+namespace gbwt
+{
+
+/*
+  fast_locate.h: Run-boundary (r-index style) sampling for locate() queries.
+*/
+
+//------------------------------------------------------------------------------
+
+/*
+  An r-index style locate structure for the compressed GBWT. BWT position (v, i)
+  corresponds to text position pack(s, k), where s is the identifier of the sequence
+  visiting the position and k is the offset of the visit in the sequence. Offset 0 is
+  the endmarker before the sequence, which is at position (ENDMARKER, s).
+
+  Runs are numbered in BWT order, and the runs of record v start from comp_to_run[comp].
+  Each position in the endmarker record is a separate run. The structure stores:
+
+  - samples[r]: the text position at the start of run r.
+  - phi_keys, phi_values: a sampled representation of phi(x), the text position at the
+    BWT position following the position of x. If x is not a key, phi(x) = phi(p) + x - p,
+    where p is the predecessor of x among the keys. The keys are the text positions
+    following the ends of runs.
+
+  Given the text position at the start of a range (the toehold), locate() lists the rest
+  of the range with phi() in O(log) time per occurrence without LF() walks, and the
+  space depends on the number of runs rather than the length of the text. find() and
+  extend() keep track of the toehold, and they use the checkpoints of the records to
+  skip to the range. Without a toehold, locate() uses the sample if the range starts a
+  run. Otherwise it falls back to GBWT::locate() with the DA samples.
+
+  The structure is built from a GBWT and serialized separately. It stores the node
+  offset, the alphabet size, and the total length of the GBWT for compatibility checks.
+  The GBWT must not be deleted or moved while the structure refers to it.
+*/
+
+class FastLocate
+{
+public:
+  typedef GBWT::size_type size_type;
+
+  const static std::string EXTENSION; // .ri
+
+//------------------------------------------------------------------------------
+
+  FastLocate();
+  explicit FastLocate(const GBWT& source);
+
+  void swap(FastLocate& another);
+
+  size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
+  void load(std::istream& in);
+
+  // Use the structure with the GBWT. Returns false if the structure was not built for it.
+  bool setGBWT(const GBWT& source);
+
+  FastLocate(const FastLocate&) = delete;
+  FastLocate& operator= (const FastLocate&) = delete;
+
+//------------------------------------------------------------------------------
+
+  /*
+    Statistics.
+  */
+
+  size_type runs() const { return this->samples.size(); }
+  bool empty() const { return (this->runs() == 0); }
+  size_type keys() const { return this->phi_values.size(); }
+
+  // Text positions.
+  size_type pack(size_type sequence, size_type offset) const { return sequence * this->max_length + offset; }
+  size_type seqId(size_type text_position) const { return text_position / this->max_length; }
+  size_type seqOffset(size_type text_position) const { return text_position % this->max_length; }
+
+//------------------------------------------------------------------------------
+
+  /*
+    High-level interface. On error or failed search, the return values are the same as
+    in GBWT, and the text position is invalid_offset().
+  */
+
+  // Also sets 'first' to the text position at the start of the range.
+  template<class Iterator>
+  SearchState find(Iterator begin, Iterator end, size_type& first) const;
+
+  // Updates 'first' to the text position at the start of the new range.
+  SearchState extend(SearchState state, node_type node, size_type& first) const;
+
+  /*
+    Returns the sorted sequence identifiers for the range. 'first' is the text position
+    at the start of the range from find() / extend() or invalid_offset() if it is not
+    known. The second version replaces the contents of 'result'.
+  */
+  std::vector<size_type> locate(SearchState state, size_type first = invalid_offset()) const;
+  void locate(SearchState state, std::vector<size_type>& result, size_type first = invalid_offset()) const;
+
+//------------------------------------------------------------------------------
+
+  /*
+    Low-level interface. The interface assumes that the parameters are valid.
+  */
+
+  // Text position at the BWT position following the position of 'text_position'.
+  size_type phi(size_type text_position) const
+  {
+    size_type rank = this->phi_rank(text_position + 1);
+    return this->phi_values[rank - 1] + (text_position - this->phi_select(rank));
+  }
+
+  // Text position at BWT position (node, i) or invalid_offset() if i does not start a run.
+  size_type textPosition(node_type node, size_type i) const;
+
+//------------------------------------------------------------------------------
+
+  const GBWT*                      index;
+
+  size_type                        max_length; // Longest sequence + 2.
+  size_type                        node_offset, alphabet_size, total_length;
+
+  sdsl::int_vector<0>              samples;
+  sdsl::int_vector<0>              comp_to_run;
+
+  sdsl::sd_vector<>                phi_keys;
+  sdsl::sd_vector<>::rank_1_type   phi_rank;
+  sdsl::sd_vector<>::select_1_type phi_select;
+  sdsl::int_vector<0>              phi_values;
+
+//------------------------------------------------------------------------------
+
+private:
+  // Sample at the start of the given run of the record.
+  size_type runSample(comp_type comp, size_type run, size_type run_start) const
+  {
+    return this->samples[this->comp_to_run[comp] + (comp == 0 ? run_start : run)];
+  }
+}; // class FastLocate
+
+//------------------------------------------------------------------------------
+
+/*
+  Template query implementations.
+*/
+
+template<class Iterator>
+SearchState
+FastLocate::find(Iterator begin, Iterator end, size_type& first) const
+{
+  first = invalid_offset();
+  if(begin == end) { return SearchState(); }
+
+  SearchState state = gbwt::find(*(this->index), *begin);
+  if(state.empty() || this->index->nodeSize(state.node) == 0) { return SearchState(); }
+  first = this->textPosition(state.node, 0);
+  ++begin;
+
+  while(begin != end && !(state.empty()))
+  {
+    state = this->extend(state, *begin, first);
+    ++begin;
+  }
+  return state;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwt
+
+#endif // GBWT_FAST_LOCATE_H
@@ -37,9 +37,74 @@ namespace gbwt
 
 //------------------------------------------------------------------------------
 
+/*
+  Sampling policies for the DA samples. The policy is chosen when the first sequences
+  are inserted, and it is stored in the GBWT header. Every policy samples the last
+  position of each sequence (the endmarker), and the interval bounds the distance
+  between the other samples. Outdegrees are those at the time of insertion.
+
+  - INTERVAL: Sample every 'interval'th position of each sequence.
+  - BRANCHING: Also sample all positions in records with outdegree > 1.
+  - DEGREE: Also sample the positions at record offsets that are multiples of
+    (interval / outdegree). During construction, the offset is the one at the time of
+    insertion, and later insertions into the record may shift the sampled positions.
+    Resampling uses the final offsets.
+  - DENSE: Sample every position. Intended for small panels.
+  - MIXED: A merged GBWT with samples from different policies. Further insertions
+    use the interval policy.
+*/
+
+struct SamplePolicy
+{
+  typedef gbwt::size_type size_type;
+
+  enum policy_type : std::uint32_t { INTERVAL = 0, BRANCHING = 1, DEGREE = 2, DENSE = 3, MIXED = 4 };
+
+  const static size_type DEFAULT_INTERVAL = 1024; // Positions in a sequence.
+
+  static std::string name(std::uint32_t policy);
+
+  // Returns false if the name is not a valid policy that can be used for construction.
+  static bool parse(const std::string& name, policy_type& policy);
+
+  /*
+    Should position 'iteration' of a sequence be sampled, when the position is at
+    'offset' in a record with the given outdegree?
+  */
+  static bool sample(std::uint32_t policy, size_type interval, size_type iteration, size_type offset, size_type outdegree)
+  {
+    switch(policy)
+    {
+      case BRANCHING:
+        return (outdegree > 1 || iteration % interval == 0);
+      case DEGREE:
+        return (iteration % interval == 0 ||
+                offset % std::max(interval / std::max(outdegree, size_type(1)), size_type(1)) == 0);
+      case DENSE:
+        return true;
+      default:
+        return (iteration % interval == 0);
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+
 /*
   GBWT file header.
 
+  Version 4:
+  - Sampling policy and sample interval after the flags.
+  - Compatible with versions 0 to 3. Older versions use the default interval policy.
+
+  Version 3:
+  - Record sizes after the sequence start directory.
+  - Compatible with versions 0 to 2.
+
+  Version 2:
+  - Sequence start directory after the DA samples.
+  - Compatible with versions 0 and 1.
+
   Version 1:
   - The first proper version.
   - Identical to version 0.
@@ -59,6 +124,8 @@ struct GBWTHeader
   std::uint64_t offset;         // Range [1..offset] of the alphabet is empty.
   std::uint64_t alphabet_size;  // Largest node id + 1.
   std::uint64_t flags;
+  std::uint32_t sample_policy;
+  std::uint64_t sample_interval;
 
   const static std::uint32_t TAG = 0x6B376B37;
   const static std::uint32_t VERSION = Version::GBWT_VERSION;
@@ -68,9 +135,12 @@ struct GBWTHeader
 
   size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
   void load(std::istream& in);
-  bool check(std::uint32_t expected_version = VERSION) const;
+  bool check() const; // Accepts versions MIN_VERSION to VERSION.
   bool checkNew() const;
 
+  // Records the sampling policy. DENSE always uses interval 1.
+  void setSampling(SamplePolicy::policy_type policy, size_type interval);
+
   void swap(GBWTHeader& another);
 
   bool operator==(const GBWTHeader& another) const;
@@ -85,25 +85,40 @@ public:
     must be InputIterators. On error or failed search, the return values will be the
     following:
 
-    find     empty search state
-    prefix   empty search state
-    extend   empty search state
-    locate   invalid_sequence() or empty vector
-    extract  empty vector
+    find       empty search state
+    prefix     empty search state
+    extend     empty search state
+    extendAll  empty vector
+    locate     invalid_sequence() or empty vector
+    extract    empty vector
   */
 
+  // Batch search that keeps several queries in flight. See gbwt::find().
+  std::vector<SearchState> find(const std::vector<std::vector<node_type>>& queries) const { return gbwt::find(*this, queries); }
+
+  // Batch search that extends each distinct prefix only once. See gbwt::findShared().
+  std::vector<SearchState> findShared(const std::vector<std::vector<node_type>>& queries) const { return gbwt::findShared(*this, queries); }
+
+  // Uses the prefix table and the unary chains if they are available.
   template<class Iterator>
-  SearchState find(Iterator begin, Iterator end) const { return gbwt::find(*this, begin, end); }
+  SearchState find(Iterator begin, Iterator end) const;
 
   SearchState prefix(node_type node) const { return gbwt::prefix(*this, node); }
 
   template<class Iterator>
-  SearchState prefix(Iterator begin, Iterator end) const { return gbwt::prefix(*this, begin, end); }
+  SearchState prefix(Iterator begin, Iterator end) const
+  {
+    return this->extend(SearchState(ENDMARKER, 0, this->sequences() - 1), begin, end);
+  }
 
   SearchState extend(SearchState state, node_type node) const { return gbwt::extend(*this, state, node); }
 
+  // Returns the non-empty extensions to all successor nodes.
+  std::vector<SearchState> extendAll(SearchState state) const { return gbwt::extendAll(*this, state); }
+
+  // Uses the unary chains if they are available.
   template<class Iterator>
-  SearchState extend(SearchState state, Iterator begin, Iterator end) const { return gbwt::extend(*this, state, begin, end); }
+  SearchState extend(SearchState state, Iterator begin, Iterator end) const;
 
   size_type locate(node_type node, size_type i) const { return gbwt::locate(*this, range_type(node, i)); }
   size_type locate(edge_type position) const { return gbwt::locate(*this, position); }
@@ -111,7 +126,69 @@ public:
   std::vector<size_type> locate(node_type node, range_type range) const { return this->locate(SearchState(node, range)); }
   std::vector<size_type> locate(SearchState state) const;
 
-  std::vector<node_type> extract(size_type sequence) const { return gbwt::extract(*this, sequence); }
+  // Replaces the contents of 'result' and uses 'context' as scratch space. See gbwt::locate().
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, strategy);
+  }
+  void locate(SearchState state, std::vector<size_type>& result, QueryContext& context, const LocateStrategy& costs,
+              LocateStrategy::strategy_type strategy = LocateStrategy::AUTOMATIC) const
+  {
+    gbwt::locate(*this, state, result, context, costs, strategy);
+  }
+
+  // Incremental locate() that can stop early. See LocateIterator.
+  LocateIterator<GBWT> locateIterator(SearchState state, size_type chunk_size = LocateStrategy::DEFAULT_CHUNK_SIZE) const
+  {
+    return LocateIterator<GBWT>(*this, state, chunk_size);
+  }
+  std::vector<size_type> locateFirst(SearchState state, size_type k) const { return gbwt::locateFirst(*this, state, k); }
+
+  // Uses the unary chains if they are available.
+  std::vector<node_type> extract(size_type sequence) const;
+  void extract(size_type sequence, std::vector<node_type>& result) const;
+
+  // Parallel batch queries. See gbwt::findAll().
+  void findAll(const std::vector<std::vector<node_type>>& queries, std::vector<SearchState>& results) const
+  {
+    gbwt::findAll(*this, queries, results);
+  }
+  void locateAll(const std::vector<SearchState>& queries, std::vector<std::vector<size_type>>& results) const
+  {
+    gbwt::locateAll(*this, queries, results);
+  }
+  void extractAll(const std::vector<size_type>& sequences, std::vector<std::vector<node_type>>& results) const
+  {
+    gbwt::extractAll(*this, sequences, results);
+  }
+
+//------------------------------------------------------------------------------
+
+  /*
+    Optional auxiliary structures. They are not serialized, and load() removes them.
+  */
+
+  // Build or remove the skip pointers over unary chains.
+  void setUnaryChains(bool enabled);
+
+  /*
+    Build a prefix table for paths of 'length' nodes or remove it with length 0. If the
+    table is present, find() uses it for the first length nodes of the pattern.
+  */
+  void setPrefixTable(size_type length, size_type max_bytes = PrefixTable::DEFAULT_MAX_BYTES);
+
+  // Load a prefix table built for this index. Returns false on failure.
+  bool loadPrefixTable(const std::string& filename);
+
+//------------------------------------------------------------------------------
+
+  /*
+    Rebuild the DA samples under a new sampling policy without rebuilding the BWT and
+    record the policy in the header. See resampleSequences() for how this differs from
+    sampling during construction.
+  */
+  void resample(SamplePolicy::policy_type policy, size_type interval = SamplePolicy::DEFAULT_INTERVAL);
 
 //------------------------------------------------------------------------------
 
@@ -143,10 +220,14 @@ public:
   comp_type toComp(node_type node) const { return (node == 0 ? node : node - this->header.offset); }
   node_type toNode(comp_type comp) const { return (comp == 0 ? comp : comp + this->header.offset); }
 
-  size_type nodeSize(node_type node) const { return this->record(node).size(); }
+  size_type nodeSize(node_type node) const { return this->record_sizes.size(this->toComp(node)); }
 
   CompressedRecord record(node_type node) const;
 
+  // Two-stage prefetch for a later query. See RecordArray::prefetch().
+  void prefetch(node_type node) const { this->bwt.prefetch(this->toComp(node)); }
+  void prefetchBody(node_type node) const { this->bwt.prefetchBody(this->toComp(node)); }
+
 //------------------------------------------------------------------------------
 
   /*
@@ -190,6 +271,24 @@ public:
     return this->record(state.node).LF(state.range, to);
   }
 
+  // Batch LF() for positions in non-decreasing order. On error: invalid_edge() for the position.
+  std::vector<edge_type> LF(node_type from, const std::vector<size_type>& positions) const
+  {
+    return this->record(from).LF(positions);
+  }
+
+  // As above, but replaces the contents of 'result'.
+  void LF(node_type from, const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+  {
+    this->record(from).LF(positions, result);
+  }
+
+  // Batch LF() for sorted non-overlapping ranges. On error: Range::empty_range() for the range.
+  std::vector<range_type> LF(node_type from, const std::vector<range_type>& ranges, node_type to) const
+  {
+    return this->record(from).LF(ranges, to);
+  }
+
 //------------------------------------------------------------------------------
 
   /*
@@ -198,7 +297,7 @@ public:
   */
 
   // Starting position of the sequence or invalid_edge() if something fails.
-  edge_type start(size_type sequence) const { return this->LF(ENDMARKER, sequence); }
+  edge_type start(size_type sequence) const { return this->sequence_starts.start(sequence); }
 
   // Returns the sampled document identifier or invalid_sequence() if there is no sample.
   size_type tryLocate(node_type node, size_type i) const
@@ -212,11 +311,41 @@ public:
     return this->da_samples.tryLocate(this->toComp(position.first), position.second);
   }
 
+  // Returns the first sample at offset >= i in the record or invalid_sample() if there is none.
+  sample_type nextSample(node_type node, size_type i) const
+  {
+    return this->da_samples.nextSample(this->toComp(node), i);
+  }
+
+  // Range locate() for a valid search state. See gbwt::locateRange().
+  void locateRange(SearchState state, std::vector<size_type>& result, QueryContext& context) const
+  {
+    gbwt::locateRange(*this, state, result, context);
+  }
+
+  // Expected number of LF() steps from a position to the next sample.
+  double sampleDistance() const
+  {
+    return (static_cast<double>(this->size()) / std::max(this->samples(), size_type(1)) + 1.0) / 2.0;
+  }
+
+  // Upper bound for the number of runs in the record. Does not decode the record.
+  size_type runBound(node_type node) const
+  {
+    comp_type comp = this->toComp(node);
+    return this->bwt.limit(comp) - this->bwt.start(comp);
+  }
+
 //------------------------------------------------------------------------------
 
-  GBWTHeader  header;
-  RecordArray bwt;
-  DASamples   da_samples;
+  GBWTHeader     header;
+  RecordArray    bwt;
+  DASamples      da_samples;
+  SequenceStarts sequence_starts;
+  RecordSizes    record_sizes;
+
+  UnaryChains    unary_chains;
+  PrefixTable    prefix_table;
 
 private:
   void copy(const GBWT& source);
@@ -224,6 +353,89 @@ private:
 
 //------------------------------------------------------------------------------
 
+/*
+  If the current node starts or continues a unary chain, we can follow the chain
+  without decoding the records, as long as the query matches the nodes on it. If the
+  query diverges from the chain, the result is the same as from LF() to a node without
+  an edge.
+*/
+
+template<class Iterator>
+SearchState
+GBWT::find(Iterator begin, Iterator end) const
+{
+  if(begin == end) { return SearchState(); }
+  if(this->prefix_table.empty())
+  {
+    SearchState state = gbwt::find(*this, *begin);
+    ++begin;
+    return this->extend(state, begin, end);
+  }
+
+  // Buffer the first nodes, as the iterators may be InputIterators.
+  node_type path[PrefixTable::MAX_LENGTH];
+  size_type length = 0;
+  while(length < this->prefix_table.length() && begin != end)
+  {
+    path[length] = *begin; ++begin; length++;
+  }
+  SearchState state;
+  if(length == this->prefix_table.length())
+  {
+    state = SearchState(path[length - 1], this->prefix_table.find(path));
+  }
+  if(state.empty())  // Not in the table.
+  {
+    state = this->extend(gbwt::find(*this, path[0]), path + 1, path + length);
+  }
+  return this->extend(state, begin, end);
+}
+
+template<class Iterator>
+SearchState
+GBWT::extend(SearchState state, Iterator begin, Iterator end) const
+{
+  if(this->unary_chains.empty()) { return gbwt::extend(*this, state, begin, end); }
+
+  while(begin != end && !(state.empty()))
+  {
+    size_type start = this->unary_chains.position(this->toComp(state.node));
+    if(start == invalid_offset())
+    {
+      state = gbwt::extend(*this, state, *begin);
+      ++begin;
+      continue;
+    }
+
+    size_type curr = start;
+    while(begin != end)
+    {
+      node_type node = *begin;
+      if(node != this->unary_chains.node(curr + 1))
+      {
+        if(!(this->contains(node))) { return SearchState(); }
+        return SearchState(node, Range::empty_range());
+      }
+      ++begin; curr++;
+      if(!(this->unary_chains.inChain(curr))) { break; }
+    }
+    size_type distance = this->unary_chains.distance(start, curr);
+    state = SearchState(this->unary_chains.node(curr), state.range.first + distance, state.range.second + distance);
+  }
+  return state;
+}
+
+//------------------------------------------------------------------------------
+
+// With a prefix table, the first step of batch find() covers the length of the paths.
+inline size_type
+findPrefixLength(const GBWT& index)
+{
+  return std::max(index.prefix_table.length(), size_type(1));
+}
+
+//------------------------------------------------------------------------------
+
 void printStatistics(const GBWT& gbwt, const std::string& name);
 
 //------------------------------------------------------------------------------
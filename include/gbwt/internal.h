@@ -26,6 +26,9 @@
 #ifndef GBWT_INTERNAL_H
 #define GBWT_INTERNAL_H
 
+#include <cstring>
+#include <limits>
+
 #include <gbwt/support.h>
 
 namespace gbwt
@@ -69,6 +72,52 @@ struct ByteCode
     return res;
   }
 
+  /*
+    As above, but for a byte array with 'limit' bytes. Single-byte values are returned
+    directly. If there are at least 8 bytes left, longer values of up to 8 bytes are
+    decoded from a single 64-bit word without data-dependent branches: the lowest clear
+    continuation bit determines the length, and the 7-bit groups are compacted in three
+    steps (pairs, quads, and octets). Longer values, the end of the array, and big-endian
+    systems use the scalar loop.
+  */
+  static value_type read(const byte_type* array, size_type& i, size_type limit)
+  {
+    if(!(array[i] & NEXT_BYTE)) { return array[i++]; }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(i + sizeof(std::uint64_t) <= limit)
+    {
+      std::uint64_t word;
+      std::memcpy(&word, array + i, sizeof(word));
+      std::uint64_t stops = ~word & 0x8080808080808080ULL;
+      if(stops != 0)
+      {
+        i += (__builtin_ctzll(stops) + 1) / BYTE_BITS;
+        word &= (stops ^ (stops - 1)) & 0x7F7F7F7F7F7F7F7FULL;
+        word = (word & 0x007F007F007F007FULL) | ((word & 0x7F007F007F007F00ULL) >> 1);
+        word = (word & 0x00003FFF00003FFFULL) | ((word & 0x3FFF00003FFF0000ULL) >> 2);
+        word = (word & 0x000000000FFFFFFFULL) | ((word & 0x0FFFFFFF00000000ULL) >> 4);
+        return word;
+      }
+    }
+#endif
+    return read(array, i);
+  }
+
+  /*
+    Reads 'n' edges encoded as (destination - previous destination, offset) pairs.
+  */
+  template<class Edge>
+  static void readEdges(const byte_type* array, size_type& i, size_type limit, Edge* edges, size_type n)
+  {
+    node_type prev = 0;
+    for(size_type j = 0; j < n; j++)
+    {
+      edges[j].first = read(array, i, limit) + prev;
+      prev = edges[j].first;
+      edges[j].second = read(array, i, limit);
+    }
+  }
+
   /*
     Encodes the value and stores it in the array using push_back().
   */
@@ -88,6 +137,12 @@ struct ByteCode
 
 /*
   Run-length encoding using ByteCode. Run lengths and alphabet size are assumed to be > 0.
+
+  If sigma < 255, short runs are encoded in a single byte as value + sigma * (length - 1).
+  The decoder replaces the division by sigma with a multiplication by a precomputed
+  reciprocal floor(2^RECIPROCAL_BITS / sigma) + 1. Because both the code and sigma are
+  less than 2^8, the product of the code and the rounding error is less than 2^16, and
+  the quotient is always exact.
 */
 
 struct Run
@@ -95,7 +150,9 @@ struct Run
   typedef ByteCode::value_type value_type;
   typedef ByteCode::code_type  code_type;
 
-  size_type sigma, run_continues;
+  const static size_type RECIPROCAL_BITS = 16;
+
+  size_type sigma, run_continues, reciprocal;
 
   explicit Run(size_type alphabet_size);
 
@@ -149,9 +206,30 @@ struct Run
     return value + this->sigma * (length - 1);
   }
 
-  run_type decodeBasic(code_type code)
+  run_type decodeBasic(code_type code) const
+  {
+    size_type quotient = (code * this->reciprocal) >> RECIPROCAL_BITS;
+    return run_type(code - quotient * this->sigma, quotient + 1);
+  }
+};
+
+/*
+  A specialized Run decoder for alphabets of size < 255, where every run starts with a
+  single-byte code. Avoids checking the encoding for every run.
+*/
+
+struct ShortRun : public Run
+{
+  explicit ShortRun(size_type alphabet_size) : Run(alphabet_size) {}
+
+  static bool supports(size_type alphabet_size) { return (alphabet_size < std::numeric_limits<code_type>::max()); }
+
+  template<class ByteArray>
+  run_type read(ByteArray& array, size_type& i)
   {
-    return run_type(code % this->sigma, code / this->sigma + 1);
+    run_type run = this->decodeBasic(array[i]); i++;
+    if(run.second >= this->run_continues) { run.second += ByteCode::read(array, i); }
+    return run;
   }
 };
 
@@ -227,12 +305,16 @@ struct Sequence
   - CompressedRecordFullIterator is the slowest, as it keeps track of the ranks
     for all successor nodes.
 
+  The iterators are templated on the run decoder. The typedefs use the generic Run,
+  while records with outdegree < 255 can use ShortRun.
+
   FIXME a single iterator with a RankCalculator as a template parameter.
 */
 
-struct CompressedRecordIterator
+template<class Decoder>
+struct BasicCompressedRecordIterator
 {
-  explicit CompressedRecordIterator(const CompressedRecord& source) :
+  explicit BasicCompressedRecordIterator(const CompressedRecord& source) :
     record(source), decoder(source.outdegree()),
     record_offset(0), curr_offset(0), next_offset(0)
   {
@@ -249,7 +331,7 @@ struct CompressedRecordIterator
   size_type offset() const { return this->record_offset; }
 
   const CompressedRecord& record;
-  Run                     decoder;
+  Decoder                 decoder;
 
   size_type               record_offset;
   size_type               curr_offset, next_offset;
@@ -266,9 +348,12 @@ private:
   }
 };
 
-struct CompressedRecordRankIterator
+typedef BasicCompressedRecordIterator<Run> CompressedRecordIterator;
+
+template<class Decoder>
+struct BasicCompressedRecordRankIterator
 {
-  explicit CompressedRecordRankIterator(const CompressedRecord& source, rank_type outrank) :
+  explicit BasicCompressedRecordRankIterator(const CompressedRecord& source, rank_type outrank) :
     record(source), decoder(source.outdegree()),
     record_offset(0), curr_offset(0), next_offset(0),
     value(outrank), result(source.offset(outrank))
@@ -289,7 +374,8 @@ struct CompressedRecordRankIterator
   // Intended for positions i covered by or after the current run. May advance the iterator.
   size_type rankAt(size_type i)
   {
-    while(this->offset() < i && !(this->end()))
+    if(this->record.checkpoint_count > 0 && this->offset() < i) { this->seek(i); }
+    while(this->offset() < i && this->next_offset < this->record.data_size)
     {
       this->curr_offset = this->next_offset;
       this->run = this->decoder.read(this->record.body, this->next_offset);
@@ -303,7 +389,7 @@ struct CompressedRecordRankIterator
   }
 
   const CompressedRecord& record;
-  Run                     decoder;
+  Decoder                 decoder;
 
   size_type               record_offset;
   size_type               curr_offset, next_offset;
@@ -322,11 +408,25 @@ private:
       if(this->run.first == value) { this->result += this->run.second; }
     }
   }
+
+  // Jump to the last checkpoint at or before offset i, if it is not before the current position.
+  void seek(size_type i)
+  {
+    size_type checkpoint = this->record.findCheckpoint(i);
+    if(checkpoint >= this->record.checkpoint_count || this->record.checkpointOffset(checkpoint) < this->offset()) { return; }
+    this->curr_offset = this->next_offset = this->record.checkpointBody(checkpoint);
+    this->record_offset = this->record.checkpointOffset(checkpoint);
+    this->result = this->record.offset(this->value) + this->record.checkpointRank(checkpoint, this->value);
+    this->read();
+  }
 };
 
-struct CompressedRecordFullIterator
+typedef BasicCompressedRecordRankIterator<Run> CompressedRecordRankIterator;
+
+template<class Decoder>
+struct BasicCompressedRecordFullIterator
 {
-  explicit CompressedRecordFullIterator(const CompressedRecord& source) :
+  explicit BasicCompressedRecordFullIterator(const CompressedRecord& source) :
     record(source), decoder(source.outdegree()), ranks(source.outgoing),
     record_offset(0), curr_offset(0), next_offset(0)
   {
@@ -349,9 +449,10 @@ struct CompressedRecordFullIterator
   // Intended for positions i covered by or after the current run. May advance the iterator.
   size_type rankAt(size_type i)
   {
+    if(this->record.checkpoint_count > 0 && this->offset() <= i) { this->seek(i); }
     while(this->offset() <= i)  // We need <= to get BWT[i].
     {
-      if(this->end()) { return invalid_offset(); }
+      if(this->next_offset >= this->record.data_size) { return invalid_offset(); }
       this->curr_offset = this->next_offset;
       this->run = this->decoder.read(this->record.body, this->next_offset);
       this->record_offset += this->run.second;
@@ -364,9 +465,10 @@ struct CompressedRecordFullIterator
   // Intended for positions i covered by or after the current run. May advance the iterator.
   edge_type edgeAt(size_type i)
   {
+    if(this->record.checkpoint_count > 0 && this->offset() <= i) { this->seek(i); }
     while(this->offset() <= i)  // We need <= to get BWT[i].
     {
-      if(this->end()) { return invalid_edge(); }
+      if(this->next_offset >= this->record.data_size) { return invalid_edge(); }
       this->curr_offset = this->next_offset;
       this->run = this->decoder.read(this->record.body, this->next_offset);
       this->record_offset += this->run.second;
@@ -379,8 +481,8 @@ struct CompressedRecordFullIterator
   }
 
   const CompressedRecord& record;
-  Run                     decoder;
-  std::vector<edge_type>  ranks;
+  Decoder                 decoder;
+  EdgeArray               ranks;
 
   size_type               record_offset;
   size_type               curr_offset, next_offset;
@@ -396,23 +498,39 @@ private:
       this->ranks[this->run.first].second += this->run.second;
     }
   }
+
+  // Jump to the last checkpoint at or before offset i, if it is not before the current position.
+  void seek(size_type i)
+  {
+    size_type checkpoint = this->record.findCheckpoint(i);
+    if(checkpoint >= this->record.checkpoint_count || this->record.checkpointOffset(checkpoint) < this->offset()) { return; }
+    this->curr_offset = this->next_offset = this->record.checkpointBody(checkpoint);
+    this->record_offset = this->record.checkpointOffset(checkpoint);
+    for(rank_type outrank = 0; outrank < this->record.outdegree(); outrank++)
+    {
+      this->ranks[outrank].second = this->record.offset(outrank) + this->record.checkpointRank(checkpoint, outrank);
+    }
+    this->read();
+  }
 };
 
+typedef BasicCompressedRecordFullIterator<Run> CompressedRecordFullIterator;
+
 //------------------------------------------------------------------------------
 
 /*
-  Iterator for DASamples. The iterator does not care about records. If the record
-  for the current sample starts at offset i, the correct sample_type is
-  (iter.offset() - i, *iter).
+  Iterator for DASamples. The iterator walks the sample blocks in order and reports
+  offsets in the concatenation of the sampled records. If the record for the current
+  sample starts at offset i, the correct sample_type is (iter.offset() - i, *iter).
 */
 
 struct SampleIterator
 {
   explicit SampleIterator(const DASamples& source) :
     data(source),
-    pos(0), sample_offset(0),
-    offset_select(&(source.sampled_offsets))
+    pos(0), rank(0), record_start(0), sample_offset(0)
   {
+    if(!(this->end())) { this->record_start = this->data.bwt_select(1); }
     this->update();
   }
 
@@ -424,17 +542,18 @@ struct SampleIterator
   size_type offset() const { return this->sample_offset; }
 
   const DASamples& data;
-  size_type        pos, sample_offset;
+  size_type        pos, rank, record_start, sample_offset;
 
 private:
-  sdsl::sd_vector<>::select_1_type offset_select;
-
   void update()
   {
-    if(!(this->end()))
+    if(this->end()) { return; }
+    if(this->data.block_starts[this->rank + 1] <= this->pos)
     {
-      this->sample_offset = this->offset_select(this->pos + 1);
+      while(this->data.block_starts[this->rank + 1] <= this->pos) { this->rank++; }
+      this->record_start = this->data.bwt_select(this->rank + 1);
     }
+    this->sample_offset = this->record_start + this->data.offsets[this->pos];
   }
 };
 
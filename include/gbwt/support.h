@@ -67,6 +67,40 @@ struct Path
 
 //------------------------------------------------------------------------------
 
+/*
+  Returns the first position i in an array of edges sorted by the first component such
+  that edges[i].first >= key, or n if there is no such position.
+
+  Short arrays are handled by counting the smaller keys. The loop has no branches that
+  depend on the data, so the compiler can vectorize it. Longer arrays use a binary search
+  where the only branch is the loop condition.
+*/
+
+const size_type EDGE_SCAN_THRESHOLD = 16;
+
+template<class Edge>
+inline size_type
+edgeLowerBound(const Edge* edges, size_type n, size_type key)
+{
+  if(n <= EDGE_SCAN_THRESHOLD)
+  {
+    size_type result = 0;
+    for(size_type i = 0; i < n; i++) { result += (edges[i].first < key); }
+    return result;
+  }
+
+  const Edge* base = edges;
+  while(n > 1)
+  {
+    size_type half = n / 2;
+    base = (base[half].first < key ? base + half : base);
+    n -= half;
+  }
+  return (base - edges) + (base->first < key);
+}
+
+//------------------------------------------------------------------------------
+
 /*
   The part of the BWT corresponding to a single node (the suffixes starting with / the
   prefixes ending with that node).
@@ -74,6 +108,11 @@ struct Path
   - Incoming edges are sorted by the source node.
   - Outgoing edges are sorted by the destination node.
   - Sampled sequence ids are sorted by the offset.
+
+  During construction, new outgoing edges are appended to the end, as the outranks are
+  used in the body. If the edges are no longer sorted, the record maintains an edge table
+  of (destination, outrank) pairs sorted by destination. The table is empty when the
+  outgoing edges are sorted, and recode() clears it.
 */
 
 struct DynamicRecord
@@ -84,6 +123,7 @@ struct DynamicRecord
   std::vector<edge_type>   incoming, outgoing;
   std::vector<run_type>    body;
   std::vector<sample_type> ids;
+  std::vector<edge_type>   edge_table;
 
 //------------------------------------------------------------------------------
 
@@ -121,6 +161,19 @@ struct DynamicRecord
   // Returns Range::empty_range() if the range is empty or the destination is invalid.
   range_type LF(range_type range, node_type to) const;
 
+  /*
+    Batch versions of LF(i) and LF(range, to) that decode the record once. The positions
+    must be in non-decreasing order, and the ranges must be sorted and non-overlapping.
+    The results are in the same order as the queries. The second version of batch LF(i)
+    replaces the contents of 'result' and does not allocate memory if it has enough capacity.
+  */
+  std::vector<edge_type> LF(const std::vector<size_type>& positions) const;
+  void LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const;
+  std::vector<range_type> LF(const std::vector<range_type>& ranges, node_type to) const;
+
+  // Returns LF(range, successor(outrank)) for every outrank using a single pass.
+  std::vector<range_type> LF(range_type range) const;
+
   // Returns BWT[i] within the record.
   node_type operator[](size_type i) const;
 
@@ -131,6 +184,9 @@ struct DynamicRecord
   // Maps successor nodes to outranks.
   rank_type edgeTo(node_type to) const;
 
+  // Add a new outgoing edge and return its outrank.
+  rank_type addOutgoing(node_type to);
+
   // These assume that 'outrank' is a valid outgoing edge.
   node_type successor(rank_type outrank) const { return this->outgoing[outrank].first; }
 #ifdef GBWT_SAVE_MEMORY
@@ -171,22 +227,84 @@ std::ostream& operator<<(std::ostream& out, const DynamicRecord& record);
 
 //------------------------------------------------------------------------------
 
+/*
+  An array of edges for record views. Up to INLINE_EDGES edges are stored inside the
+  object, so that decoding a typical record does not allocate memory. Arrays with more
+  edges fall back to a heap-allocated vector. Resizing does not preserve the contents.
+*/
+
+struct EdgeArray
+{
+  typedef gbwt::size_type size_type;
+  typedef edge_type*       iterator;
+  typedef const edge_type* const_iterator;
+
+  const static size_type INLINE_EDGES = 16;
+
+  EdgeArray() : array_size(0), edges(inline_edges) {}
+  EdgeArray(const EdgeArray& source) : array_size(0), edges(inline_edges) { this->copy(source); }
+  EdgeArray(EdgeArray&& source) : array_size(0), edges(inline_edges) { *this = std::move(source); }
+
+  EdgeArray& operator=(const EdgeArray& source);
+  EdgeArray& operator=(EdgeArray&& source);
+
+  size_type size() const { return this->array_size; }
+  bool empty() const { return (this->size() == 0); }
+  void resize(size_type new_size);
+
+  edge_type& operator[](size_type i) { return this->edges[i]; }
+  const edge_type& operator[](size_type i) const { return this->edges[i]; }
+
+  iterator begin() { return this->edges; }
+  iterator end() { return this->edges + this->array_size; }
+  const_iterator begin() const { return this->edges; }
+  const_iterator end() const { return this->edges + this->array_size; }
+
+private:
+  size_type              array_size;
+  edge_type*             edges;
+  edge_type              inline_edges[INLINE_EDGES];
+  std::vector<edge_type> heap_edges;
+
+  void copy(const EdgeArray& source);
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  A non-owning view of a record in RecordArray. The outgoing edges are decoded into
+  an EdgeArray, while the body points to the underlying data. Creating a view does
+  not allocate memory unless the outdegree exceeds EdgeArray::INLINE_EDGES.
+*/
+
 struct CompressedRecord
 {
   typedef gbwt::size_type size_type;
 
-  std::vector<edge_type> outgoing;
+  EdgeArray              outgoing;
   const byte_type*       body;
   size_type              data_size;
 
+  // Checkpoints for long records (see RecordArray) or a null pointer.
+  const sdsl::int_vector<0>* checkpoints;
+  size_type                  checkpoint_start, checkpoint_count;
+
   CompressedRecord();
   CompressedRecord(const std::vector<byte_type>& source, size_type start, size_type limit);
+  CompressedRecord(const byte_type* source, size_type start, size_type limit);
 
   size_type size() const; // Expensive.
   bool empty() const { return (this->size() == 0); }
   size_type runs() const; // Expensive.
   size_type outdegree() const { return this->outgoing.size(); }
 
+  /*
+    Unary records have outdegree 1 and a body consisting of a single run. Queries on
+    them do not need the body beyond the first run. If the record is unary, this sets
+    'record_size' and returns true.
+  */
+  bool unary(size_type& record_size) const;
+
   // Returns (node, LF(i, node)) or invalid_edge() if the offset is invalid.
   edge_type LF(size_type i) const;
 
@@ -199,6 +317,19 @@ struct CompressedRecord
   // Returns Range::empty_range() if the range is empty or the destination is invalid.
   range_type LF(range_type range, node_type to) const;
 
+  /*
+    Batch versions of LF(i) and LF(range, to) that decode the record once. The positions
+    must be in non-decreasing order, and the ranges must be sorted and non-overlapping.
+    The results are in the same order as the queries. The second version of batch LF(i)
+    replaces the contents of 'result' and does not allocate memory if it has enough capacity.
+  */
+  std::vector<edge_type> LF(const std::vector<size_type>& positions) const;
+  void LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const;
+  std::vector<range_type> LF(const std::vector<range_type>& ranges, node_type to) const;
+
+  // Returns LF(range, successor(outrank)) for every outrank using a single pass.
+  std::vector<range_type> LF(range_type range) const;
+
   // Returns BWT[i] within the record.
   node_type operator[](size_type i) const;
 
@@ -210,19 +341,85 @@ struct CompressedRecord
   // These assume that 'outrank' is a valid outgoing edge.
   node_type successor(rank_type outrank) const { return this->outgoing[outrank].first; }
   size_type offset(rank_type outrank) const { return this->outgoing[outrank].second; }
+
+  // Returns the last checkpoint at BWT offset <= i or checkpoint_count if there is none.
+  size_type findCheckpoint(size_type i) const;
+
+  // Number of values stored for each checkpoint.
+  size_type checkpointWidth() const { return this->outdegree() + 3; }
+
+  // These assume that 'checkpoint' is a valid checkpoint.
+  size_type checkpointBody(size_type checkpoint) const
+  {
+    return (*(this->checkpoints))[this->checkpoint_start + checkpoint * this->checkpointWidth()];
+  }
+  size_type checkpointOffset(size_type checkpoint) const
+  {
+    return (*(this->checkpoints))[this->checkpoint_start + checkpoint * this->checkpointWidth() + 1];
+  }
+  size_type checkpointRuns(size_type checkpoint) const
+  {
+    return (*(this->checkpoints))[this->checkpoint_start + checkpoint * this->checkpointWidth() + 2];
+  }
+  size_type checkpointRank(size_type checkpoint, rank_type outrank) const
+  {
+    return (*(this->checkpoints))[this->checkpoint_start + checkpoint * this->checkpointWidth() + 3 + outrank];
+  }
 };
 
 //------------------------------------------------------------------------------
 
+/*
+  The records of a compressed GBWT, concatenated into a single byte array.
+
+  Records with long bodies also have an in-memory checkpoint index. Each checkpoint is
+  located at a run boundary and consists of (body offset, BWT offset, number of runs
+  before the checkpoint, number of occurrences of each outrank before the checkpoint). The checkpoints of record
+  checkpoint_records[i] are stored in checkpoint_data starting from checkpoint_starts[i].
+  The index is not serialized. It is rebuilt in buildIndex() and load().
+
+  By default, record boundaries are found with select queries on the sd_vector. The
+  optional dense directory (DIRECTORY_DENSE) trades memory for speed. It stores an
+  8-byte entry for each record, making record() a single memory access in the common
+  case:
+
+  - Records of at most DIRECTORY_INLINE_BYTES bytes are stored in the entry. The first
+    byte is (length << 1) | 1, followed by the record.
+  - For other records, the first byte is 0, followed by the starting offset (5 bytes)
+    and the length (2 bytes), both in LSB order. If the length does not fit into the
+    entry, the limit of the record is found with select.
+
+  The directory is not serialized. Choose the mode with setDirectory() after building
+  or loading the index. The mode is preserved over subsequent load() calls.
+*/
+
 struct RecordArray
 {
   typedef gbwt::size_type size_type;
 
+  const static size_type CHECKPOINT_INTERVAL = GBWT_CHECKPOINT_INTERVAL;  // Bytes.
+
+  const static size_type DIRECTORY_NONE  = 0;
+  const static size_type DIRECTORY_DENSE = 1;
+
+  const static size_type DIRECTORY_INLINE_BYTES = sizeof(std::uint64_t) - 1;
+  const static size_type DIRECTORY_OFFSET_BYTES = 5;
+  const static size_type DIRECTORY_LENGTH_BYTES = 2;
+
+  const static size_type PREFETCH_BYTES = 4 * CACHE_LINE_BYTES;
+
   size_type                        records;
   sdsl::sd_vector<>                index;
   sdsl::sd_vector<>::select_1_type select;
   std::vector<byte_type>           data;
 
+  std::vector<size_type>           checkpoint_records;
+  std::vector<size_type>           checkpoint_starts;
+  sdsl::int_vector<0>              checkpoint_data;
+
+  size_type                        directory_mode;
+  std::vector<std::uint64_t>       directory;
+
   RecordArray();
   RecordArray(const RecordArray& source);
   RecordArray(RecordArray&& source);
@@ -249,12 +446,74 @@ struct RecordArray
     return (record + 1 < this->records ? this->select(record + 2) : this->data.size());
   }
 
+  // Returns a view of the record with access to the checkpoints.
+  CompressedRecord record(size_type record) const;
+
+  /*
+    Two-stage prefetch for a later record() call. prefetch() prefetches the data needed
+    for finding the record: the directory entry or the low bits that select() reads for
+    the start and the limit. prefetchBody() finds the record, which should then hit the
+    cache, and prefetches up to PREFETCH_BYTES from its start. There should be other
+    work between the stages. Without the directory, select() may still miss the cache
+    in the high bits of the sd_vector.
+  */
+  void prefetch(size_type record) const
+  {
+    if(this->directory_mode == DIRECTORY_DENSE) { prefetchRead(this->directory.data() + record); }
+    else if(this->index.low.width() > 0)
+    {
+      const sdsl::int_vector<>& low = this->index.low;
+      size_type first = record * low.width(), last = first + 2 * low.width() - 1;
+      prefetchRead(low.data() + (first >> 6));
+      prefetchRead(low.data() + (last >> 6));
+    }
+  }
+  void prefetchBody(size_type record) const;
+
+  // Builds or removes the dense directory. Returns false if the mode is not supported.
+  bool setDirectory(size_type mode);
+
+  /*
+    The distance between checkpoints in a record with the given outdegree. Because each
+    checkpoint stores a rank for every outgoing edge, the interval grows with the
+    outdegree to keep the index small relative to the record.
+  */
+  static size_type checkpointInterval(size_type outdegree)
+  {
+    return std::max(CHECKPOINT_INTERVAL, 4 * outdegree);
+  }
+
 private:
   void copy(const RecordArray& source);
+  void buildCheckpoints();
+  bool buildDirectory();
+
+  void findRecord(size_type record, size_type& start, size_type& limit) const;
 };
 
 //------------------------------------------------------------------------------
 
+struct RecordSizes;
+
+/*
+  Document array samples. In memory, the samples of each sampled record are stored in
+  a contiguous block:
+
+  - block_starts[r] is the number of samples in sampled records of rank < r, for
+    r <= number of sampled records.
+  - The samples of the record of rank r are at j in [block_starts[r], block_starts[r + 1]),
+    sorted by offsets[j]. offsets[j] is the offset within the record and array[j] is
+    the sequence identifier.
+
+  Hence tryLocate() and nextSample() need a rank query, two adjacent directory entries,
+  and a binary search in a contiguous block. The offsets are sized by the longest
+  sampled record.
+
+  The serialized representation has an sd_vector over the sampled offsets in the
+  concatenation of the sampled records. serialize() regenerates it from the blocks and
+  load() converts it back, so the file format is unchanged.
+*/
+
 struct DASamples
 {
   typedef gbwt::size_type size_type;
@@ -267,10 +526,9 @@ struct DASamples
   sdsl::sd_vector<>                bwt_ranges;
   sdsl::sd_vector<>::select_1_type bwt_select;
 
-  // Sampled offsets.
-  sdsl::sd_vector<>                sampled_offsets;
-  sdsl::sd_vector<>::rank_1_type   sample_rank;
-
+  // Sample blocks.
+  sdsl::int_vector<0>              block_starts;
+  sdsl::int_vector<0>              offsets;
   sdsl::int_vector<0>              array;
 
   DASamples();
@@ -281,6 +539,9 @@ struct DASamples
   explicit DASamples(const std::vector<DynamicRecord>& bwt);
   DASamples(const std::vector<DASamples const*> sources, const sdsl::int_vector<0>& origins, const std::vector<size_type>& record_offsets, const std::vector<size_type>& sequence_counts);
 
+  // Build from ((record, offset), sequence id) pairs sorted by position.
+  DASamples(const std::vector<std::pair<edge_type, size_type>>& samples, const RecordSizes& record_sizes);
+
   void swap(DASamples& another);
   DASamples& operator=(const DASamples& source);
   DASamples& operator=(DASamples&& source);
@@ -292,10 +553,26 @@ struct DASamples
   size_type size() const { return this->array.size(); }
 
   // Returns invalid_sequence() if there is no sample.
-  size_type tryLocate(size_type record, size_type offset) const;
+  size_type tryLocate(size_type record, size_type offset) const
+  {
+    if(!(this->isSampled(record))) { return invalid_sequence(); }
+    size_type rank = this->record_rank(record);
+    size_type limit = this->block_starts[rank + 1];
+    size_type i = this->firstSample(this->block_starts[rank], limit, offset);
+    if(i < limit && this->offsets[i] == offset) { return this->array[i]; }
+    return invalid_sequence();
+  }
 
   // Returns the first sample at >= offset or invalid_sample() if there is no sample.
-  sample_type nextSample(size_type record, size_type offset) const;
+  sample_type nextSample(size_type record, size_type offset) const
+  {
+    if(!(this->isSampled(record))) { return invalid_sample(); }
+    size_type rank = this->record_rank(record);
+    size_type limit = this->block_starts[rank + 1];
+    size_type i = this->firstSample(this->block_starts[rank], limit, offset);
+    if(i < limit) { return sample_type(this->offsets[i], this->array[i]); }
+    return invalid_sample();
+  }
 
   bool isSampled(size_type record) const { return this->sampled_records[record]; }
 
@@ -308,6 +585,246 @@ struct DASamples
 private:
   void copy(const DASamples& source);
   void setVectors();
+
+  // Allocate block_starts and offsets. 'max_length' is the length of the longest sampled record.
+  void initBlocks(size_type record_count, size_type sample_count, size_type max_length);
+
+  // Build the blocks from the serialized sampled offsets after loading the other structures.
+  void buildBlocks(const sdsl::sd_vector<>& sampled_offsets);
+
+  // Index of the first sample in [start, limit) at offset >= 'offset'.
+  size_type firstSample(size_type start, size_type limit, size_type offset) const
+  {
+    while(start < limit)
+    {
+      size_type mid = start + (limit - start) / 2;
+      if(this->offsets[mid] < offset) { start = mid + 1; }
+      else { limit = mid; }
+    }
+    return start;
+  }
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Record sizes as an sd_vector over prefix sums. Record i is represented by a 1-bit at
+  offset (total size of records before i) + i, so that empty records do not produce
+  duplicate positions. Retrieving the size takes two select operations instead of
+  decoding the record.
+*/
+
+struct RecordSizes
+{
+  typedef gbwt::size_type size_type;
+
+  sdsl::sd_vector<>                prefix_sums;
+  sdsl::sd_vector<>::select_1_type prefix_select;
+  size_type                        records;
+
+  RecordSizes();
+  RecordSizes(const RecordSizes& source);
+  RecordSizes(RecordSizes&& source);
+  ~RecordSizes();
+
+  /*
+    Build the structure for records [0, record_count) of total size 'total_size'.
+    size_of(i) must return the size of record i.
+  */
+  template<class SizeFunction>
+  RecordSizes(size_type record_count, size_type total_size, SizeFunction size_of) :
+    records(record_count)
+  {
+    sdsl::sd_vector_builder builder(total_size + record_count, record_count);
+    for(size_type i = 0, offset = 0; i < record_count; i++)
+    {
+      builder.set(offset + i);
+      offset += size_of(i);
+    }
+    this->prefix_sums = sdsl::sd_vector<>(builder);
+    sdsl::util::init_support(this->prefix_select, &(this->prefix_sums));
+  }
+
+  void swap(RecordSizes& another);
+  RecordSizes& operator=(const RecordSizes& source);
+  RecordSizes& operator=(RecordSizes&& source);
+
+  size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
+  void load(std::istream& in);
+
+  // Assumes that 'record' is valid.
+  size_type size(size_type record) const
+  {
+    size_type start = this->prefix_select(record + 1);
+    size_type limit = (record + 1 < this->records ? this->prefix_select(record + 2) : this->prefix_sums.size());
+    return limit - start - 1;
+  }
+
+private:
+  void copy(const RecordSizes& source);
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Starting positions of the sequences: start(i) == LF(ENDMARKER, i). The positions are
+  stored in two bit-packed arrays, so that they can be retrieved in constant time
+  without decoding the endmarker record.
+*/
+
+struct SequenceStarts
+{
+  typedef gbwt::size_type size_type;
+
+  sdsl::int_vector<0> nodes;
+  sdsl::int_vector<0> offsets;
+
+  SequenceStarts();
+
+  // Build the directory from the endmarker record.
+  explicit SequenceStarts(const DynamicRecord& endmarker);
+  explicit SequenceStarts(const CompressedRecord& endmarker);
+
+  // Concatenate the sources. Used when merging indexes with non-overlapping node ids.
+  explicit SequenceStarts(const std::vector<SequenceStarts const*> sources);
+
+  void swap(SequenceStarts& another);
+
+  size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
+  void load(std::istream& in);
+
+  size_type size() const { return this->nodes.size(); }
+  bool empty() const { return (this->size() == 0); }
+
+  // Returns invalid_edge() if there is no such sequence.
+  edge_type start(size_type sequence) const
+  {
+    if(sequence >= this->size()) { return invalid_edge(); }
+    return edge_type(this->nodes[sequence], this->offsets[sequence]);
+  }
+
+private:
+  void build(const std::vector<edge_type>& positions);
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Skip pointers over unary chains: paths of records with outdegree 1. In such a record,
+  LF(i) == (successor, offset + i), so following a chain only needs the nodes on it and
+  the sum of the edge offsets.
+
+  The unary records (excluding the endmarker) are partitioned into chains. A chain
+  continues from a unary record to its successor, if the successor is also unary and
+  has no other unary predecessors. Each chain is stored in 'nodes' as the nodes of the
+  chain followed by the exit node, which is the successor of the last node. If 'nodes'
+  contains a unary node at slot i, positions[comp] == i + 1; otherwise positions[comp]
+  is 0. offsets[i] is the sum of the edge offsets before slot i, counting only the
+  unary records. Hence the offset transform from slot i to slot j within the same
+  chain is distance(i, j) = offsets[j] - offsets[i].
+
+  The structure is optional and built in memory from a RecordArray.
+*/
+
+struct UnaryChains
+{
+  typedef gbwt::size_type size_type;
+
+  sdsl::int_vector<0> positions;
+  sdsl::int_vector<0> nodes;
+  sdsl::int_vector<0> offsets;
+  size_type           node_offset;
+
+  UnaryChains();
+
+  // 'offset' is the node identifier offset of the GBWT.
+  UnaryChains(const RecordArray& bwt, size_type offset);
+
+  void swap(UnaryChains& another);
+
+  size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
+  void load(std::istream& in);
+
+  // Number of slots, including the exit nodes.
+  size_type size() const { return this->nodes.size(); }
+  bool empty() const { return (this->size() == 0); }
+
+  // Returns the slot of the record or invalid_offset() if the record is not in a chain.
+  size_type position(comp_type comp) const
+  {
+    if(comp >= this->positions.size() || this->positions[comp] == 0) { return invalid_offset(); }
+    return this->positions[comp] - 1;
+  }
+
+  // These assume that 'slot' is valid.
+  node_type node(size_type slot) const { return this->nodes[slot]; }
+  bool inChain(size_type slot) const
+  {
+    node_type node = this->nodes[slot];
+    return (this->positions[node == ENDMARKER ? node : node - this->node_offset] == slot + 1);
+  }
+  size_type distance(size_type from, size_type to) const { return this->offsets[to] - this->offsets[from]; }
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  A table of BWT ranges for all node paths of a fixed length (2 or 3) in the GBWT. The
+  paths are stored in lexicographic order in 'paths' with path_length nodes each, and
+  'ranges' stores the BWT range in the record of the last node as two values per path.
+  The range for path P is the same as the range of the search state from find(P).
+
+  If the table would not fit in 'max_bytes', only the paths with the highest haplotype
+  support (range length) are kept. Hence a path missing from the table may still exist
+  in the GBWT. The cap is applied during construction. The threads merge their candidate
+  paths into a shared bounded heap through small buffers, so the temporary space is
+  proportional to 'max_bytes' regardless of the number of threads.
+
+  The table is optional. It is built in parallel from a RecordArray and serialized
+  separately from the GBWT. It stores the node offset, the alphabet size, and the total
+  length of the GBWT for compatibility checks.
+*/
+
+struct PrefixTable
+{
+  typedef gbwt::size_type size_type;
+
+  const static size_type MIN_LENGTH = 2;
+  const static size_type MAX_LENGTH = 3;
+  const static size_type DEFAULT_MAX_BYTES = 64 * MEGABYTE;
+
+  const static std::string EXTENSION; // .prefix
+
+  size_type           path_length;
+  sdsl::int_vector<0> paths;
+  sdsl::int_vector<0> ranges;
+  size_type           node_offset, alphabet_size, total_length;
+
+  PrefixTable();
+
+  // 'offset' is the node identifier offset of the GBWT.
+  PrefixTable(const RecordArray& bwt, size_type offset, size_type length, size_type max_bytes = DEFAULT_MAX_BYTES);
+
+  void swap(PrefixTable& another);
+
+  size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const;
+  void load(std::istream& in);
+
+  // Number of paths.
+  size_type size() const { return (this->path_length == 0 ? 0 : this->paths.size() / this->path_length); }
+  bool empty() const { return (this->size() == 0); }
+  size_type length() const { return this->path_length; }
+
+  // Returns the range for a path of length() nodes or Range::empty_range() if the path is not in the table.
+  range_type find(const node_type* path) const;
+
+  // As above, but returns Range::empty_range() if the number of nodes is not length().
+  range_type find(node_type first, node_type second) const;
+  range_type find(node_type first, node_type second, node_type third) const;
+
+private:
+  // Lexicographic comparison of the path at 'index' and 'path'.
+  int compare(size_type index, const node_type* path) const;
 };
 
 //------------------------------------------------------------------------------
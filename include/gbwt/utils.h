@@ -54,6 +54,17 @@ namespace gbwt
 
 #define GBWT_SAVE_MEMORY
 
+/*
+  Long records in the compressed GBWT get an in-memory checkpoint index, which allows
+  starting the decoding from the middle of the record. There is a checkpoint roughly
+  every GBWT_CHECKPOINT_INTERVAL bytes of the record body. Smaller values make the
+  queries faster in the worst case but use more memory. Value 0 disables the index.
+*/
+
+#ifndef GBWT_CHECKPOINT_INTERVAL
+#define GBWT_CHECKPOINT_INTERVAL 1024
+#endif
+
 //------------------------------------------------------------------------------
 
 typedef std::uint64_t size_type;
@@ -206,7 +217,7 @@ struct Version
   const static size_type MINOR_VERSION = 3;
   const static size_type PATCH_VERSION = 0;
 
-  const static size_type GBWT_VERSION  = 1;
+  const static size_type GBWT_VERSION  = 4;
 };
 
 //------------------------------------------------------------------------------
@@ -220,6 +231,31 @@ bit_length(IntegerType val)
 
 //------------------------------------------------------------------------------
 
+// Hint that the data at the address will be read soon. No-op on unsupported compilers.
+inline void
+prefetchRead(const void* address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0, 3);
+#else
+  (void)address;
+#endif
+}
+
+const size_type CACHE_LINE_BYTES = 64;
+
+// Prefetch the cache lines covering [address, address + bytes).
+inline void
+prefetchRange(const void* address, size_type bytes)
+{
+  if(bytes == 0) { return; }
+  std::uintptr_t curr = reinterpret_cast<std::uintptr_t>(address) & ~(std::uintptr_t)(CACHE_LINE_BYTES - 1);
+  std::uintptr_t last = reinterpret_cast<std::uintptr_t>(address) + bytes - 1;
+  for(; curr <= last; curr += CACHE_LINE_BYTES) { prefetchRead(reinterpret_cast<const void*>(curr)); }
+}
+
+//------------------------------------------------------------------------------
+
 const size_type FNV_OFFSET_BASIS = 0xcbf29ce484222325UL;
 const size_type FNV_PRIME        = 0x100000001b3UL;
 
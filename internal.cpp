@@ -30,14 +30,17 @@ namespace gbwt
 
 //------------------------------------------------------------------------------
 
+const size_type Run::RECIPROCAL_BITS;
+
 Run::Run(size_type alphabet_size) :
   sigma(alphabet_size),
-  run_continues(0)
+  run_continues(0), reciprocal(0)
 {
   size_type max_code = std::numeric_limits<code_type>::max();
   if(this->sigma < max_code)
   {
     this->run_continues = (max_code + 1) / this->sigma;
+    this->reciprocal = (static_cast<size_type>(1) << RECIPROCAL_BITS) / this->sigma + 1;
   }
 }
 
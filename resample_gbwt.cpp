@@ -0,0 +1,307 @@
+/*
+  Copyright (c) 2017 Jouni Siren
+  Copyright (c) 2017 Genome Research Ltd.
+
+  Author: Jouni Siren <jouni.siren@iki.fi>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include <unistd.h>
+
+#include <gbwt/dynamic_gbwt.h>
+
+using namespace gbwt;
+
+//------------------------------------------------------------------------------
+
+const std::string tool_name = "GBWT resampling";
+
+const size_type MAX_ERRORS = 100; // Do not print more error messages.
+size_type errors           = 0;
+
+void printUsage(int exit_code = EXIT_SUCCESS);
+
+void verifyGaps(const GBWT& index);
+void verifyDegree(const GBWT& index);
+void verifyRebuild(const GBWT& index);
+
+//------------------------------------------------------------------------------
+
+int
+main(int argc, char** argv)
+{
+  if(argc < 2) { printUsage(); }
+
+  SamplePolicy::policy_type sample_policy = SamplePolicy::INTERVAL;
+  size_type sample_interval = SamplePolicy::DEFAULT_INTERVAL;
+  bool verify_index = false;
+  std::string input_base, output_base;
+  int c = 0;
+  while((c = getopt(argc, argv, "o:s:S:v")) != -1)
+  {
+    switch(c)
+    {
+    case 'o':
+      output_base = optarg; break;
+    case 's':
+      if(!SamplePolicy::parse(optarg, sample_policy))
+      {
+        std::cerr << "resample_gbwt: Invalid sampling policy: " << optarg << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      break;
+    case 'S':
+      sample_interval = std::stoul(optarg); break;
+    case 'v':
+      verify_index = true; break;
+    case '?':
+      std::exit(EXIT_FAILURE);
+    default:
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if(optind + 1 != argc) { printUsage(EXIT_FAILURE); }
+  input_base = argv[optind];
+  if(output_base.empty()) { output_base = input_base; }
+  if(sample_policy == SamplePolicy::DENSE) { sample_interval = 1; }
+
+  Version::print(std::cout, tool_name);
+
+  printHeader("Input name"); std::cout << input_base << std::endl;
+  printHeader("Output name"); std::cout << output_base << std::endl;
+  printHeader("Sampling"); std::cout << SamplePolicy::name(sample_policy) << " (interval " << sample_interval << ")" << std::endl;
+  std::cout << std::endl;
+
+  double start = readTimer();
+
+  GBWT index;
+  sdsl::load_from_file(index, input_base + GBWT::EXTENSION);
+  printStatistics(index, input_base);
+
+  index.resample(sample_policy, sample_interval);
+  std::string gbwt_name = output_base + GBWT::EXTENSION;
+  sdsl::store_to_file(index, gbwt_name);
+  printStatistics(index, output_base);
+
+  double seconds = readTimer() - start;
+
+  std::cout << "Resampled " << index.size() << " nodes in " << seconds << " seconds ("
+            << (index.size() / seconds) << " nodes/second)" << std::endl;
+  std::cout << "Memory usage " << inGigabytes(memoryUsage()) << " GB" << std::endl;
+  std::cout << std::endl;
+
+  if(verify_index)
+  {
+    std::cout << "Verifying the index..." << std::endl;
+    double verify_start = readTimer();
+    std::cout << std::endl;
+
+    GBWT compressed_index;
+    sdsl::load_from_file(compressed_index, gbwt_name);
+    verifyGaps(compressed_index);
+    verifyDegree(compressed_index);
+    verifyRebuild(compressed_index);
+
+    double verify_seconds = readTimer() - verify_start;
+    if(errors > 0) { std::cout << "Index verification failed" << std::endl; }
+    else { std::cout << "Index verified in " << verify_seconds << " seconds" << std::endl; }
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void
+printUsage(int exit_code)
+{
+  Version::print(std::cerr, tool_name);
+
+  std::cerr << "Usage: resample_gbwt [options] input" << std::endl;
+  std::cerr << "  -o X  Use base name X for output (default: the input)" << std::endl;
+  std::cerr << "  -s X  Use sampling policy X (interval, branching, degree, dense; default: interval)" << std::endl;
+  std::cerr << "  -S N  Use sample interval N (default: " << SamplePolicy::DEFAULT_INTERVAL << ")" << std::endl;
+  std::cerr << "  -v    Verify the samples after resampling" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Rebuilds the DA samples of a compressed GBWT without rebuilding the BWT." << std::endl;
+  std::cerr << std::endl;
+
+  std::exit(exit_code);
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Follow each sequence with LF() and check that the samples have the correct sequence
+  identifiers, that the last position is sampled, and that the distance between samples
+  never exceeds the sample interval. This does not depend on the resampling code.
+*/
+
+void
+verifyGaps(const GBWT& index)
+{
+  std::cout << "Verifying sample gaps..." << std::endl;
+
+  double start = readTimer();
+  size_type initial_errors = errors;
+  std::atomic<size_type> samples_found(0);
+  size_type interval = index.header.sample_interval;
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_type sequence = 0; sequence < index.sequences(); sequence++)
+  {
+    edge_type curr(ENDMARKER, sequence);
+    size_type iteration = 1, last_sample = 0;
+    while(true)
+    {
+      edge_type next = index.LF(curr);
+      size_type sample = index.tryLocate(curr);
+      bool failed = false;
+      if(sample != invalid_sequence())
+      {
+        samples_found++;
+        failed = (sample != sequence || iteration - last_sample > interval);
+        last_sample = iteration;
+      }
+      else { failed = (next.first == ENDMARKER || iteration - last_sample >= interval); }
+      if(failed)
+      {
+        #pragma omp critical
+        {
+          errors++;
+          if(errors <= MAX_ERRORS)
+          {
+            std::cerr << "verifyGaps(): Verification failed with sequence " << sequence << ", position " << curr
+                      << " (iteration " << iteration << ", previous sample at iteration " << last_sample << ")" << std::endl;
+            std::cerr << "verifyGaps(): Sample had sequence id " << (sample == invalid_sequence() ? std::string("none") : std::to_string(sample)) << std::endl;
+          }
+        }
+        break;
+      }
+      if(next.first == ENDMARKER) { break; }
+      curr = next; iteration++;
+    }
+  }
+
+  if(samples_found != index.samples())
+  {
+    errors++;
+    if(errors <= MAX_ERRORS)
+    {
+      std::cerr << "verifyGaps(): Found " << samples_found << " samples, expected " << index.samples() << std::endl;
+    }
+  }
+
+  double seconds = readTimer() - start;
+  if(errors > initial_errors) { std::cout << "Gap verification failed" << std::endl; }
+  else { std::cout << "Sample gaps verified in " << seconds << " seconds" << std::endl; }
+  std::cout << std::endl;
+}
+
+/*
+  With degree-aware sampling, check that every record offset that is a multiple of
+  (interval / outdegree) is sampled. This holds after resampling, which uses the final
+  offsets and outdegrees.
+*/
+
+void
+verifyDegree(const GBWT& index)
+{
+  if(index.header.sample_policy != SamplePolicy::DEGREE) { return; }
+
+  std::cout << "Verifying degree-aware sample density..." << std::endl;
+
+  double start = readTimer();
+  size_type initial_errors = errors;
+  size_type interval = index.header.sample_interval;
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(comp_type comp = 1; comp < index.effective(); comp++)
+  {
+    node_type node = index.toNode(comp);
+    size_type outdegree = index.record(node).outdegree(), record_size = index.nodeSize(node);
+    size_type step = std::max(interval / std::max(outdegree, size_type(1)), size_type(1));
+    for(size_type offset = 0; offset < record_size; offset += step)
+    {
+      if(index.tryLocate(node, offset) != invalid_sequence()) { continue; }
+      #pragma omp critical
+      {
+        errors++;
+        if(errors <= MAX_ERRORS)
+        {
+          std::cerr << "verifyDegree(): Position (" << node << ", " << offset << ") is not sampled (outdegree " << outdegree << ")" << std::endl;
+        }
+      }
+      break;
+    }
+  }
+
+  double seconds = readTimer() - start;
+  if(errors > initial_errors) { std::cout << "Sample density verification failed" << std::endl; }
+  else { std::cout << "Sample density verified in " << seconds << " seconds" << std::endl; }
+  std::cout << std::endl;
+}
+
+/*
+  Rebuild the index from the extracted sequences with the same sampling policy and compare
+  the samples. Branching and degree-aware sampling use the outdegrees and record offsets
+  at insertion time during construction and the final ones in resampling, so the
+  comparison is only possible with interval and dense sampling.
+*/
+
+void
+verifyRebuild(const GBWT& index)
+{
+  if(index.header.sample_policy != SamplePolicy::INTERVAL && index.header.sample_policy != SamplePolicy::DENSE)
+  {
+    std::cout << "Skipping the rebuild comparison with " << SamplePolicy::name(index.header.sample_policy) << " sampling" << std::endl;
+    std::cout << std::endl;
+    return;
+  }
+
+  std::cout << "Verifying samples against a rebuilt index..." << std::endl;
+
+  double start = readTimer();
+  size_type initial_errors = errors;
+
+  std::vector<node_type> text, sequence;
+  text.reserve(index.size());
+  for(size_type i = 0; i < index.sequences(); i++)
+  {
+    index.extract(i, sequence);
+    text.insert(text.end(), sequence.begin(), sequence.end());
+    text.push_back(ENDMARKER);
+  }
+  DynamicGBWT rebuilt;
+  rebuilt.setSampling(static_cast<SamplePolicy::policy_type>(index.header.sample_policy), index.header.sample_interval);
+  rebuilt.insert(text);
+  sdsl::util::clear(text);
+
+  errors += gbwt::verifySamples(index, rebuilt, (errors < MAX_ERRORS ? MAX_ERRORS - errors : 0));
+
+  double seconds = readTimer() - start;
+  if(errors > initial_errors) { std::cout << "Sample verification failed" << std::endl; }
+  else { std::cout << "Samples verified in " << seconds << " seconds" << std::endl; }
+  std::cout << std::endl;
+}
+
+//------------------------------------------------------------------------------
@@ -47,6 +47,7 @@ DynamicRecord::swap(DynamicRecord& another)
     this->outgoing.swap(another.outgoing);
     this->body.swap(another.body);
     this->ids.swap(another.ids);
+    this->edge_table.swap(another.edge_table);
   }
 }
 
@@ -66,6 +67,7 @@ DynamicRecord::recode()
 
   for(run_type& run : this->body) { run.first = this->successor(run.first); }
   sequentialSort(this->outgoing.begin(), this->outgoing.end());
+  this->edge_table = std::vector<edge_type>();
   for(run_type& run : this->body) { run.first = this->edgeTo(run.first); }
 }
 
@@ -189,6 +191,98 @@ DynamicRecord::LF(range_type range, node_type to) const
   return range;
 }
 
+std::vector<edge_type>
+DynamicRecord::LF(const std::vector<size_type>& positions) const
+{
+  std::vector<edge_type> result; result.reserve(positions.size());
+  this->LF(positions, result);
+  return result;
+}
+
+void
+DynamicRecord::LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+{
+  result.clear();
+  EdgeArray ranks; ranks.resize(this->outdegree());
+  std::copy(this->outgoing.begin(), this->outgoing.end(), ranks.begin());
+  std::vector<run_type>::const_iterator iter = this->body.begin();
+  rank_type last_edge = 0;
+  size_type offset = 0;
+  for(size_type i : positions)
+  {
+    if(i >= this->size()) { result.push_back(invalid_edge()); continue; }
+    while(offset <= i)
+    {
+      last_edge = iter->first;
+      ranks[iter->first].second += iter->second;
+      offset += iter->second;
+      ++iter;
+    }
+    result.push_back(edge_type(ranks[last_edge].first, ranks[last_edge].second - (offset - i)));
+  }
+}
+
+std::vector<range_type>
+DynamicRecord::LF(const std::vector<range_type>& ranges, node_type to) const
+{
+  std::vector<range_type> result(ranges.size(), Range::empty_range());
+  size_type outrank = this->edgeTo(to);
+  if(outrank >= this->outdegree()) { return result; }
+
+  // Invariant: 'rank' is the number of occurrences of 'outrank' before 'offset'.
+  std::vector<run_type>::const_iterator iter = this->body.begin();
+  size_type offset = 0, rank = this->offset(outrank);
+  auto rank_at = [&](size_type i) -> size_type
+  {
+    while(iter != this->body.end() && offset + iter->second <= i)
+    {
+      if(iter->first == outrank) { rank += iter->second; }
+      offset += iter->second;
+      ++iter;
+    }
+    if(iter != this->body.end() && iter->first == outrank && i > offset) { return rank + (i - offset); }
+    return rank;
+  };
+
+  for(size_type j = 0; j < ranges.size(); j++)
+  {
+    if(Range::empty(ranges[j])) { continue; }
+    result[j].first = rank_at(ranges[j].first);
+    result[j].second = rank_at(ranges[j].second + 1) - 1;
+  }
+  return result;
+}
+
+std::vector<range_type>
+DynamicRecord::LF(range_type range) const
+{
+  std::vector<range_type> result(this->outdegree(), Range::empty_range());
+  if(Range::empty(range)) { return result; }
+
+  // Invariant: ranks[outrank].second is the number of occurrences of 'outrank' before 'offset'.
+  std::vector<edge_type> ranks(this->outgoing);
+  std::vector<run_type>::const_iterator iter = this->body.begin();
+  size_type offset = 0;
+  for(size_type pass = 0; pass < 2; pass++)
+  {
+    size_type i = (pass == 0 ? range.first : range.second + 1);
+    while(iter != this->body.end() && offset + iter->second <= i)
+    {
+      ranks[iter->first].second += iter->second;
+      offset += iter->second;
+      ++iter;
+    }
+    for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
+    {
+      size_type rank = ranks[outrank].second;
+      if(iter != this->body.end() && iter->first == outrank && i > offset) { rank += i - offset; }
+      if(pass == 0) { result[outrank].first = rank; }
+      else { result[outrank].second = rank - 1; }
+    }
+  }
+  return result;
+}
+
 node_type
 DynamicRecord::operator[](size_type i) const
 {
@@ -209,21 +303,37 @@ DynamicRecord::operator[](size_type i) const
 bool
 DynamicRecord::hasEdge(node_type to) const
 {
-  for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
+  return (this->edgeTo(to) < this->outdegree());
+}
+
+rank_type
+DynamicRecord::edgeTo(node_type to) const
+{
+  if(this->edge_table.empty())
   {
-    if(this->successor(outrank) == to) { return true; }
+    rank_type outrank = edgeLowerBound(this->outgoing.data(), this->outdegree(), to);
+    return (outrank < this->outdegree() && this->successor(outrank) == to ? outrank : this->outdegree());
   }
-  return false;
+
+  size_type i = edgeLowerBound(this->edge_table.data(), this->edge_table.size(), to);
+  return (i < this->edge_table.size() && this->edge_table[i].first == to ? this->edge_table[i].second : this->outdegree());
 }
 
 rank_type
-DynamicRecord::edgeTo(node_type to) const
+DynamicRecord::addOutgoing(node_type to)
 {
-  for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
+  rank_type outrank = this->outdegree();
+  this->outgoing.push_back(edge_type(to, 0));
+  if(this->edge_table.empty())
   {
-    if(this->successor(outrank) == to) { return outrank; }
+    if(outrank == 0 || this->successor(outrank - 1) <= to) { return outrank; }
+    this->edge_table.reserve(this->outdegree());
+    for(rank_type i = 0; i < outrank; i++) { this->edge_table.push_back(edge_type(this->successor(i), i)); }
   }
-  return this->outdegree();
+
+  size_type i = edgeLowerBound(this->edge_table.data(), this->edge_table.size(), to);
+  this->edge_table.insert(this->edge_table.begin() + i, edge_type(to, outrank));
+  return outrank;
 }
 
 //------------------------------------------------------------------------------
@@ -231,28 +341,21 @@ DynamicRecord::edgeTo(node_type to) const
 rank_type
 DynamicRecord::findFirst(node_type from) const
 {
-  for(size_type i = 0; i < this->indegree(); i++)
-  {
-    if(this->incoming[i].first >= from) { return i; }
-  }
-  return this->indegree();
+  return edgeLowerBound(this->incoming.data(), this->indegree(), from);
 }
 
 void
 DynamicRecord::increment(node_type from)
 {
-  for(rank_type inrank = 0; inrank < this->indegree(); inrank++)
-  {
-    if(this->predecessor(inrank) == from) { this->count(inrank)++; return; }
-  }
-  this->addIncoming(edge_type(from, 1));
+  rank_type inrank = this->findFirst(from);
+  if(inrank < this->indegree() && this->predecessor(inrank) == from) { this->count(inrank)++; return; }
+  this->incoming.insert(this->incoming.begin() + inrank, edge_type(from, 1));
 }
 
 void
 DynamicRecord::addIncoming(edge_type inedge)
 {
-  this->incoming.push_back(inedge);
-  sequentialSort(this->incoming.begin(), this->incoming.end());
+  this->incoming.insert(std::upper_bound(this->incoming.begin(), this->incoming.end(), inedge), inedge);
 }
 
 //------------------------------------------------------------------------------
@@ -284,55 +387,212 @@ operator<<(std::ostream& out, const DynamicRecord& record)
 
 //------------------------------------------------------------------------------
 
-CompressedRecord::CompressedRecord() :
-  outgoing(), body(0), data_size(0)
+EdgeArray&
+EdgeArray::operator=(const EdgeArray& source)
 {
+  if(this != &source) { this->copy(source); }
+  return *this;
 }
 
-CompressedRecord::CompressedRecord(const std::vector<byte_type>& source, size_type start, size_type limit)
+EdgeArray&
+EdgeArray::operator=(EdgeArray&& source)
 {
-  this->outgoing.resize(ByteCode::read(source, start));
-  node_type prev = 0;
-  for(edge_type& outedge : this->outgoing)
+  if(this != &source)
   {
-    outedge.first = ByteCode::read(source, start) + prev;
-    prev = outedge.first;
-    outedge.second = ByteCode::read(source, start);
+    if(source.size() > INLINE_EDGES)
+    {
+      this->heap_edges = std::move(source.heap_edges);
+      this->array_size = source.array_size;
+      this->edges = this->heap_edges.data();
+      source.array_size = 0; source.edges = source.inline_edges;
+    }
+    else { this->copy(source); }
+  }
+  return *this;
+}
+
+void
+EdgeArray::resize(size_type new_size)
+{
+  if(new_size > INLINE_EDGES)
+  {
+    this->heap_edges.resize(new_size);
+    this->edges = this->heap_edges.data();
   }
+  else { this->edges = this->inline_edges; }
+  this->array_size = new_size;
+}
+
+void
+EdgeArray::copy(const EdgeArray& source)
+{
+  this->resize(source.size());
+  std::copy(source.begin(), source.end(), this->begin());
+}
+
+//------------------------------------------------------------------------------
+
+CompressedRecord::CompressedRecord() :
+  outgoing(), body(0), data_size(0),
+  checkpoints(0), checkpoint_start(0), checkpoint_count(0)
+{
+}
+
+CompressedRecord::CompressedRecord(const std::vector<byte_type>& source, size_type start, size_type limit) :
+  CompressedRecord(source.data(), start, limit)
+{
+}
+
+CompressedRecord::CompressedRecord(const byte_type* source, size_type start, size_type limit) :
+  checkpoints(0), checkpoint_start(0), checkpoint_count(0)
+{
+  this->outgoing.resize(ByteCode::read(source, start, limit));
+  ByteCode::readEdges(source, start, limit, this->outgoing.begin(), this->outdegree());
 
-  this->body = source.data() + start;
+  this->body = source + start;
   this->data_size = limit - start;
 }
 
+/*
+  Specialized query implementations. The public functions dispatch once per record:
+  unary records are answered directly, records with a small outdegree use ShortRun,
+  and the rest use the generic Run decoder.
+*/
+
+template<class Decoder>
 size_type
-CompressedRecord::size() const
+recordSize(const CompressedRecord& record)
 {
   size_type result = 0;
-  if(this->outdegree() > 0)
-  {
-    for(CompressedRecordIterator iter(*this); !(iter.end()); ++iter) { result += iter->second; }
-  }
+  for(BasicCompressedRecordIterator<Decoder> iter(record); !(iter.end()); ++iter) { result += iter->second; }
   return result;
 }
 
+template<class Decoder>
 size_type
-CompressedRecord::runs() const
+recordRuns(const CompressedRecord& record)
 {
   size_type result = 0;
-  if(this->outdegree() > 0)
+  for(BasicCompressedRecordIterator<Decoder> iter(record); !(iter.end()); ++iter) { result++; }
+  return result;
+}
+
+template<class Decoder>
+edge_type
+recordRunLF(const CompressedRecord& record, size_type i, size_type& run_end)
+{
+  BasicCompressedRecordFullIterator<Decoder> iter(record);
+  edge_type result = iter.edgeAt(i);
+  if(result != invalid_edge()) { run_end = iter.offset() - 1; }
+  return result;
+}
+
+template<class Decoder>
+range_type
+recordRange(const CompressedRecord& record, range_type range, rank_type outrank)
+{
+  BasicCompressedRecordRankIterator<Decoder> iter(record, outrank);
+  range.first = iter.rankAt(range.first);
+  range.second = iter.rankAt(range.second + 1) - 1;
+  return range;
+}
+
+template<class Decoder>
+size_type
+recordRank(const CompressedRecord& record, size_type i, rank_type outrank)
+{
+  BasicCompressedRecordRankIterator<Decoder> iter(record, outrank);
+  return iter.rankAt(i);
+}
+
+template<class Decoder>
+void
+recordBatchLF(const CompressedRecord& record, const std::vector<size_type>& positions, std::vector<edge_type>& result)
+{
+  BasicCompressedRecordFullIterator<Decoder> iter(record);
+  for(size_type i : positions) { result.push_back(iter.edgeAt(i)); }
+}
+
+template<class Decoder>
+void
+recordBatchRange(const CompressedRecord& record, const std::vector<range_type>& ranges, rank_type outrank, std::vector<range_type>& result)
+{
+  BasicCompressedRecordRankIterator<Decoder> iter(record, outrank);
+  for(size_type j = 0; j < ranges.size(); j++)
   {
-    for(CompressedRecordIterator iter(*this); !(iter.end()); ++iter) { result++; }
+    if(Range::empty(ranges[j])) { continue; }
+    result[j].first = iter.rankAt(ranges[j].first);
+    result[j].second = iter.rankAt(ranges[j].second + 1) - 1;
   }
-  return result;
+}
+
+template<class Decoder>
+void
+recordRanges(const CompressedRecord& record, range_type range, std::vector<range_type>& result)
+{
+  BasicCompressedRecordFullIterator<Decoder> iter(record);
+  for(size_type pass = 0; pass < 2; pass++)
+  {
+    size_type i = (pass == 0 ? range.first : range.second + 1);
+    bool past_end = (iter.rankAt(i) == invalid_offset()); // All runs have been processed.
+    for(rank_type outrank = 0; outrank < record.outdegree(); outrank++)
+    {
+      size_type rank = iter.rank(outrank);
+      if(!past_end && iter.run.first == outrank) { rank -= iter.offset() - i; }
+      if(pass == 0) { result[outrank].first = rank; }
+      else { result[outrank].second = rank - 1; }
+    }
+  }
+}
+
+template<class Decoder>
+node_type
+recordAccess(const CompressedRecord& record, size_type i)
+{
+  for(BasicCompressedRecordIterator<Decoder> iter(record); !(iter.end()); ++iter)
+  {
+    if(iter.offset() > i) { return record.successor(iter->first); }
+  }
+  return ENDMARKER;
+}
+
+bool
+CompressedRecord::unary(size_type& record_size) const
+{
+  if(this->outdegree() != 1 || this->data_size == 0) { return false; }
+  ShortRun decoder(1);
+  size_type i = 0;
+  run_type run = decoder.read(this->body, i);
+  if(i < this->data_size) { return false; }
+  record_size = run.second;
+  return true;
+}
+
+size_type
+CompressedRecord::size() const
+{
+  if(this->outdegree() == 0) { return 0; }
+  size_type record_size = 0;
+  if(this->unary(record_size)) { return record_size; }
+  if(ShortRun::supports(this->outdegree())) { return recordSize<ShortRun>(*this); }
+  return recordSize<Run>(*this);
+}
+
+size_type
+CompressedRecord::runs() const
+{
+  if(this->outdegree() == 0) { return 0; }
+  size_type record_size = 0;
+  if(this->unary(record_size)) { return 1; }
+  if(ShortRun::supports(this->outdegree())) { return recordRuns<ShortRun>(*this); }
+  return recordRuns<Run>(*this);
 }
 
 edge_type
 CompressedRecord::LF(size_type i) const
 {
-  if(this->outdegree() == 0) { return invalid_edge(); }
-
-  CompressedRecordFullIterator iter(*this);
-  return iter.edgeAt(i);
+  size_type run_end = 0;
+  return this->runLF(i, run_end);
 }
 
 edge_type
@@ -340,10 +600,15 @@ CompressedRecord::runLF(size_type i, size_type& run_end) const
 {
   if(this->outdegree() == 0) { return invalid_edge(); }
 
-  CompressedRecordFullIterator iter(*this);
-  edge_type result = iter.edgeAt(i);
-  if(result != invalid_edge()) { run_end = iter.offset() - 1; }
-  return result;
+  size_type record_size = 0;
+  if(this->unary(record_size))
+  {
+    if(i >= record_size) { return invalid_edge(); }
+    run_end = record_size - 1;
+    return edge_type(this->successor(0), this->offset(0) + i);
+  }
+  if(ShortRun::supports(this->outdegree())) { return recordRunLF<ShortRun>(*this, i, run_end); }
+  return recordRunLF<Run>(*this, i, run_end);
 }
 
 size_type
@@ -351,8 +616,11 @@ CompressedRecord::LF(size_type i, node_type to) const
 {
   size_type outrank = this->edgeTo(to);
   if(outrank >= this->outdegree()) { return invalid_offset(); }
-  CompressedRecordRankIterator iter(*this, outrank);
-  return iter.rankAt(i);
+
+  size_type record_size = 0;
+  if(this->unary(record_size)) { return this->offset(0) + std::min(i, record_size); }
+  if(ShortRun::supports(this->outdegree())) { return recordRank<ShortRun>(*this, i, outrank); }
+  return recordRank<Run>(*this, i, outrank);
 }
 
 range_type
@@ -362,11 +630,84 @@ CompressedRecord::LF(range_type range, node_type to) const
 
   size_type outrank = this->edgeTo(to);
   if(outrank >= this->outdegree()) { return Range::empty_range(); }
-  CompressedRecordRankIterator iter(*this, outrank);
-  range.first = iter.rankAt(range.first);
-  range.second = iter.rankAt(range.second + 1) - 1;
 
-  return range;
+  size_type record_size = 0;
+  if(this->unary(record_size))
+  {
+    return range_type(this->offset(0) + std::min(range.first, record_size),
+                      this->offset(0) + std::min(range.second + 1, record_size) - 1);
+  }
+  if(ShortRun::supports(this->outdegree())) { return recordRange<ShortRun>(*this, range, outrank); }
+  return recordRange<Run>(*this, range, outrank);
+}
+
+std::vector<edge_type>
+CompressedRecord::LF(const std::vector<size_type>& positions) const
+{
+  std::vector<edge_type> result; result.reserve(positions.size());
+  this->LF(positions, result);
+  return result;
+}
+
+void
+CompressedRecord::LF(const std::vector<size_type>& positions, std::vector<edge_type>& result) const
+{
+  result.clear();
+  if(this->outdegree() == 0)
+  {
+    result.resize(positions.size(), invalid_edge());
+    return;
+  }
+
+  size_type record_size = 0;
+  if(this->unary(record_size))
+  {
+    for(size_type i : positions)
+    {
+      result.push_back(i < record_size ? edge_type(this->successor(0), this->offset(0) + i) : invalid_edge());
+    }
+  }
+  else if(ShortRun::supports(this->outdegree())) { recordBatchLF<ShortRun>(*this, positions, result); }
+  else { recordBatchLF<Run>(*this, positions, result); }
+}
+
+std::vector<range_type>
+CompressedRecord::LF(const std::vector<range_type>& ranges, node_type to) const
+{
+  std::vector<range_type> result(ranges.size(), Range::empty_range());
+  size_type outrank = this->edgeTo(to);
+  if(outrank >= this->outdegree()) { return result; }
+
+  size_type record_size = 0;
+  if(this->unary(record_size))
+  {
+    for(size_type j = 0; j < ranges.size(); j++)
+    {
+      if(Range::empty(ranges[j])) { continue; }
+      result[j] = range_type(this->offset(0) + std::min(ranges[j].first, record_size),
+                             this->offset(0) + std::min(ranges[j].second + 1, record_size) - 1);
+    }
+  }
+  else if(ShortRun::supports(this->outdegree())) { recordBatchRange<ShortRun>(*this, ranges, outrank, result); }
+  else { recordBatchRange<Run>(*this, ranges, outrank, result); }
+  return result;
+}
+
+std::vector<range_type>
+CompressedRecord::LF(range_type range) const
+{
+  std::vector<range_type> result(this->outdegree(), Range::empty_range());
+  if(Range::empty(range) || this->outdegree() == 0) { return result; }
+
+  size_type record_size = 0;
+  if(this->unary(record_size))
+  {
+    result[0] = range_type(this->offset(0) + std::min(range.first, record_size),
+                           this->offset(0) + std::min(range.second + 1, record_size) - 1);
+  }
+  else if(ShortRun::supports(this->outdegree())) { recordRanges<ShortRun>(*this, range, result); }
+  else { recordRanges<Run>(*this, range, result); }
+  return result;
 }
 
 node_type
@@ -374,37 +715,53 @@ CompressedRecord::operator[](size_type i) const
 {
   if(this->outdegree() == 0) { return ENDMARKER; }
 
-  for(CompressedRecordIterator iter(*this); !(iter.end()); ++iter)
-  {
-    if(iter.offset() > i) { return this->successor(iter->first); }
-  }
-  return ENDMARKER;
+  size_type record_size = 0;
+  if(this->unary(record_size)) { return (i < record_size ? this->successor(0) : ENDMARKER); }
+  if(ShortRun::supports(this->outdegree())) { return recordAccess<ShortRun>(*this, i); }
+  return recordAccess<Run>(*this, i);
 }
 
 bool
 CompressedRecord::hasEdge(node_type to) const
 {
-  for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
-  {
-    if(this->successor(outrank) == to) { return true; }
-  }
-  return false;
+  return (this->edgeTo(to) < this->outdegree());
 }
 
 rank_type
 CompressedRecord::edgeTo(node_type to) const
 {
-  for(rank_type outrank = 0; outrank < this->outdegree(); outrank++)
+  rank_type outrank = edgeLowerBound(this->outgoing.begin(), this->outdegree(), to);
+  return (outrank < this->outdegree() && this->successor(outrank) == to ? outrank : this->outdegree());
+}
+
+size_type
+CompressedRecord::findCheckpoint(size_type i) const
+{
+  if(this->checkpoint_count == 0 || this->checkpointOffset(0) > i) { return this->checkpoint_count; }
+
+  // Invariant: checkpointOffset(low) <= i < checkpointOffset(high).
+  size_type low = 0, high = this->checkpoint_count;
+  while(high - low > 1)
   {
-    if(this->successor(outrank) == to) { return outrank; }
+    size_type mid = low + (high - low) / 2;
+    if(this->checkpointOffset(mid) <= i) { low = mid; }
+    else { high = mid; }
   }
-  return this->outdegree();
+  return low;
 }
 
 //------------------------------------------------------------------------------
 
+const size_type RecordArray::CHECKPOINT_INTERVAL;
+const size_type RecordArray::DIRECTORY_NONE;
+const size_type RecordArray::DIRECTORY_DENSE;
+const size_type RecordArray::DIRECTORY_INLINE_BYTES;
+const size_type RecordArray::DIRECTORY_OFFSET_BYTES;
+const size_type RecordArray::DIRECTORY_LENGTH_BYTES;
+const size_type RecordArray::PREFETCH_BYTES;
+
 RecordArray::RecordArray() :
-  records(0)
+  records(0), directory_mode(DIRECTORY_NONE)
 {
 }
 
@@ -423,7 +780,7 @@ RecordArray::~RecordArray()
 }
 
 RecordArray::RecordArray(const std::vector<DynamicRecord>& bwt) :
-  records(bwt.size())
+  records(bwt.size()), directory_mode(DIRECTORY_NONE)
 {
   // Find the starting offsets and compress the BWT.
   std::vector<size_type> offsets(bwt.size());
@@ -437,7 +794,7 @@ RecordArray::RecordArray(const std::vector<DynamicRecord>& bwt) :
 }
 
 RecordArray::RecordArray(const std::vector<RecordArray const*> sources, const sdsl::int_vector<0>& origins, const std::vector<size_type>& record_offsets) :
-  records(origins.size())
+  records(origins.size()), directory_mode(DIRECTORY_NONE)
 {
   size_type data_size = 0;
   for(auto source : sources) { data_size += source->data.size(); }
@@ -491,8 +848,8 @@ RecordArray::RecordArray(const std::vector<RecordArray const*> sources, const sd
 
 
 RecordArray::RecordArray(size_type array_size) :
-  records(array_size)
-{  
+  records(array_size), directory_mode(DIRECTORY_NONE)
+{
 }
 
 void
@@ -502,47 +859,220 @@ RecordArray::buildIndex(const std::vector<size_type>& offsets)
   for(size_type offset : offsets) { builder.set(offset); }
   this->index = sdsl::sd_vector<>(builder);
   sdsl::util::init_support(this->select, &(this->index));
+  this->buildCheckpoints();
+  this->buildDirectory();
 }
 
 void
-RecordArray::swap(RecordArray& another)
+RecordArray::buildCheckpoints()
 {
-  if(this != &another)
+  this->checkpoint_records.clear();
+  this->checkpoint_starts.clear();
+  sdsl::util::clear(this->checkpoint_data);
+  if(CHECKPOINT_INTERVAL == 0) { return; }
+
+  std::vector<size_type> values;
+  size_type max_value = 0;
+  for(size_type record = 0; record < this->records; record++)
   {
-    std::swap(this->records, another.records),
-    this->index.swap(another.index);
-    sdsl::util::swap_support(this->select, another.select, &(this->index), &(another.index));
-    this->data.swap(another.data);
+    size_type start = this->start(record), limit = this->limit(record);
+    if(limit - start < CHECKPOINT_INTERVAL) { continue; }
+    CompressedRecord current(this->data, start, limit);
+    if(current.outdegree() == 0) { continue; }
+    size_type interval = checkpointInterval(current.outdegree());
+    if(current.data_size < 2 * interval) { continue; }
+
+    size_type first = values.size(), threshold = interval, runs = 0;
+    std::vector<size_type> counts(current.outdegree(), 0);
+    for(CompressedRecordIterator iter(current); !(iter.end()); ++iter, runs++)
+    {
+      if(iter.curr_offset >= threshold)
+      {
+        values.push_back(iter.curr_offset);
+        values.push_back(iter.offset() - iter->second);
+        values.push_back(runs);
+        values.insert(values.end(), counts.begin(), counts.end());
+        max_value = std::max(max_value, std::max(iter.curr_offset, iter.offset())); // Byte offset may exceed BWT offset.
+        threshold = iter.curr_offset + interval;
+      }
+      counts[iter->first] += iter->second;
+    }
+    if(values.size() > first)
+    {
+      this->checkpoint_records.push_back(record);
+      this->checkpoint_starts.push_back(first);
+    }
   }
+  this->checkpoint_starts.push_back(values.size());
+
+  this->checkpoint_data = sdsl::int_vector<0>(values.size(), 0, bit_length(max_value));
+  for(size_type i = 0; i < values.size(); i++) { this->checkpoint_data[i] = values[i]; }
 }
 
-RecordArray&
-RecordArray::operator=(const RecordArray& source)
+bool
+RecordArray::setDirectory(size_type mode)
 {
-  if(this != &source) { this->copy(source); }
-  return *this;
+  if(mode != DIRECTORY_NONE && mode != DIRECTORY_DENSE) { return false; }
+  this->directory_mode = mode;
+  return this->buildDirectory();
 }
 
-RecordArray&
-RecordArray::operator=(RecordArray&& source)
+bool
+RecordArray::buildDirectory()
 {
-  if(this != &source)
+  this->directory.clear(); this->directory.shrink_to_fit();
+  if(this->directory_mode == DIRECTORY_NONE) { return true; }
+  if(this->data.size() >= ((size_type)1 << (DIRECTORY_OFFSET_BYTES * BYTE_BITS)))
   {
-    this->records = std::move(source.records);
-    this->index = std::move(source.index);
-    this->select = std::move(source.select); this->select.set_vector(&(this->index));
-    this->data = std::move(source.data);
+    std::cerr << "RecordArray::buildDirectory(): The records are too large for the dense directory" << std::endl;
+    this->directory_mode = DIRECTORY_NONE;
+    return false;
   }
-  return *this;
+
+  this->directory.resize(this->records, 0);
+  const size_type max_length = ((size_type)1 << (DIRECTORY_LENGTH_BYTES * BYTE_BITS)) - 1;
+  for(size_type record = 0, start = 0; record < this->records; record++)
+  {
+    size_type limit = this->limit(record), length = limit - start;
+    byte_type* entry = (byte_type*)(this->directory.data() + record);
+    if(length <= DIRECTORY_INLINE_BYTES)
+    {
+      entry[0] = (length << 1) | 1;
+      for(size_type i = 0; i < length; i++) { entry[i + 1] = this->data[start + i]; }
+    }
+    else
+    {
+      entry[0] = 0;
+      for(size_type i = 0; i < DIRECTORY_OFFSET_BYTES; i++)
+      {
+        entry[i + 1] = (start >> (i * BYTE_BITS)) & 0xFF;
+      }
+      length = std::min(length, max_length);
+      for(size_type i = 0; i < DIRECTORY_LENGTH_BYTES; i++)
+      {
+        entry[i + 1 + DIRECTORY_OFFSET_BYTES] = (length >> (i * BYTE_BITS)) & 0xFF;
+      }
+    }
+    start = limit;
+  }
+
+  return true;
 }
 
-size_type
-RecordArray::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+void
+RecordArray::findRecord(size_type record, size_type& start, size_type& limit) const
 {
-  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
-  size_type written_bytes = 0;
-
-  written_bytes += sdsl::write_member(this->records, out, child, "records");
+  const byte_type* entry = (const byte_type*)(this->directory.data() + record);
+  start = 0; limit = 0;
+  for(size_type i = 0; i < DIRECTORY_OFFSET_BYTES; i++)
+  {
+    start |= (size_type)(entry[i + 1]) << (i * BYTE_BITS);
+  }
+  for(size_type i = 0; i < DIRECTORY_LENGTH_BYTES; i++)
+  {
+    limit |= (size_type)(entry[i + 1 + DIRECTORY_OFFSET_BYTES]) << (i * BYTE_BITS);
+  }
+  if(limit == ((size_type)1 << (DIRECTORY_LENGTH_BYTES * BYTE_BITS)) - 1) { limit = this->limit(record); }
+  else { limit += start; }
+}
+
+CompressedRecord
+RecordArray::record(size_type record) const
+{
+  size_type start = 0, limit = 0;
+  if(this->directory_mode == DIRECTORY_DENSE)
+  {
+    const byte_type* entry = (const byte_type*)(this->directory.data() + record);
+    if(entry[0] & 1) { return CompressedRecord(entry + 1, 0, entry[0] >> 1); }
+    this->findRecord(record, start, limit);
+  }
+  else
+  {
+    start = this->start(record); limit = this->limit(record);
+  }
+
+  CompressedRecord result(this->data, start, limit);
+  if(result.data_size >= CHECKPOINT_INTERVAL && !(this->checkpoint_records.empty()))
+  {
+    std::vector<size_type>::const_iterator iter =
+      std::lower_bound(this->checkpoint_records.begin(), this->checkpoint_records.end(), record);
+    if(iter != this->checkpoint_records.end() && *iter == record)
+    {
+      size_type i = iter - this->checkpoint_records.begin();
+      result.checkpoints = &(this->checkpoint_data);
+      result.checkpoint_start = this->checkpoint_starts[i];
+      result.checkpoint_count = (this->checkpoint_starts[i + 1] - this->checkpoint_starts[i]) / result.checkpointWidth();
+    }
+  }
+  return result;
+}
+
+void
+RecordArray::prefetchBody(size_type record) const
+{
+  size_type start = 0, limit = 0;
+  if(this->directory_mode == DIRECTORY_DENSE)
+  {
+    const byte_type* entry = (const byte_type*)(this->directory.data() + record);
+    if(entry[0] & 1) { return; }
+    this->findRecord(record, start, limit);
+  }
+  else
+  {
+    start = this->start(record); limit = this->limit(record);
+  }
+  prefetchRange(this->data.data() + start, std::min(limit - start, PREFETCH_BYTES));
+}
+
+void
+RecordArray::swap(RecordArray& another)
+{
+  if(this != &another)
+  {
+    std::swap(this->records, another.records),
+    this->index.swap(another.index);
+    sdsl::util::swap_support(this->select, another.select, &(this->index), &(another.index));
+    this->data.swap(another.data);
+    this->checkpoint_records.swap(another.checkpoint_records);
+    this->checkpoint_starts.swap(another.checkpoint_starts);
+    this->checkpoint_data.swap(another.checkpoint_data);
+    std::swap(this->directory_mode, another.directory_mode);
+    this->directory.swap(another.directory);
+  }
+}
+
+RecordArray&
+RecordArray::operator=(const RecordArray& source)
+{
+  if(this != &source) { this->copy(source); }
+  return *this;
+}
+
+RecordArray&
+RecordArray::operator=(RecordArray&& source)
+{
+  if(this != &source)
+  {
+    this->records = std::move(source.records);
+    this->index = std::move(source.index);
+    this->select = std::move(source.select); this->select.set_vector(&(this->index));
+    this->data = std::move(source.data);
+    this->checkpoint_records = std::move(source.checkpoint_records);
+    this->checkpoint_starts = std::move(source.checkpoint_starts);
+    this->checkpoint_data = std::move(source.checkpoint_data);
+    this->directory_mode = std::move(source.directory_mode);
+    this->directory = std::move(source.directory);
+  }
+  return *this;
+}
+
+size_type
+RecordArray::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+{
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += sdsl::write_member(this->records, out, child, "records");
   written_bytes += this->index.serialize(out, child, "index");
   written_bytes += this->select.serialize(out, child, "select");
 
@@ -570,6 +1100,9 @@ RecordArray::load(std::istream& in)
   // Read the data.
   this->data.resize(this->index.size());
   in.read((char*)(this->data.data()), this->data.size() * sizeof(byte_type));
+
+  this->buildCheckpoints();
+  this->buildDirectory();
 }
 
 void
@@ -579,6 +1112,11 @@ RecordArray::copy(const RecordArray& source)
   this->index = source.index;
   this->select = source.select; this->select.set_vector(&(this->index));
   this->data = source.data;
+  this->checkpoint_records = source.checkpoint_records;
+  this->checkpoint_starts = source.checkpoint_starts;
+  this->checkpoint_data = source.checkpoint_data;
+  this->directory_mode = source.directory_mode;
+  this->directory = source.directory;
 }
 
 //------------------------------------------------------------------------------
@@ -604,50 +1142,39 @@ DASamples::~DASamples()
 DASamples::DASamples(const std::vector<DynamicRecord>& bwt)
 {
   // Determine the statistics and mark the sampled nodes.
-  size_type record_count = 0, bwt_offsets = 0, sample_count = 0;
+  size_type record_count = 0, bwt_offsets = 0, sample_count = 0, max_length = 0, max_sample = 0;
   this->sampled_records = sdsl::bit_vector(bwt.size(), 0);
   for(size_type i = 0; i < bwt.size(); i++)
   {
     if(bwt[i].samples() > 0)
     {
       record_count++; bwt_offsets += bwt[i].size(); sample_count += bwt[i].samples();
+      max_length = std::max(max_length, bwt[i].size());
+      for(sample_type sample : bwt[i].ids) { max_sample = std::max(max_sample, (size_type)(sample.second)); }
       this->sampled_records[i] = 1;
     }
   }
   sdsl::util::init_support(this->record_rank, &(this->sampled_records));
 
-  // Build the bitvectors over BWT offsets.
+  // Build the record ranges and store the samples.
   sdsl::sd_vector_builder range_builder(bwt_offsets, record_count);
-  sdsl::sd_vector_builder offset_builder(bwt_offsets, sample_count);
-  size_type offset = 0, max_sample = 0;
+  this->initBlocks(record_count, sample_count, max_length);
+  this->array = sdsl::int_vector<0>(sample_count, 0, bit_length(max_sample));
+  size_type offset = 0, rank = 0, curr = 0;
   for(const DynamicRecord& record : bwt)
   {
-    if(record.samples() > 0)
+    if(record.samples() == 0) { continue; }
+    range_builder.set(offset);
+    this->block_starts[rank] = curr;
+    for(sample_type sample : record.ids)
     {
-      range_builder.set(offset);
-      for(sample_type sample : record.ids)
-      {
-        offset_builder.set(offset + sample.first);
-        max_sample = std::max(max_sample, (size_type)(sample.second));
-      }
-      offset += record.size();
+      this->offsets[curr] = sample.first; this->array[curr] = sample.second; curr++;
     }
+    offset += record.size(); rank++;
   }
+  this->block_starts[rank] = curr;
   this->bwt_ranges = sdsl::sd_vector<>(range_builder);
   sdsl::util::init_support(this->bwt_select, &(this->bwt_ranges));
-  this->sampled_offsets = sdsl::sd_vector<>(offset_builder);
-  sdsl::util::init_support(this->sample_rank, &(this->sampled_offsets));
-
-  // Store the samples.
-  this->array = sdsl::int_vector<0>(sample_count, 0, bit_length(max_sample));
-  size_type curr = 0;
-  for(const DynamicRecord& record : bwt)
-  {
-    if(record.samples() > 0)
-    {
-      for(sample_type sample : record.ids) { this->array[curr] = sample.second; curr++; }
-    }
-  }
 }
 
 DASamples::DASamples(const std::vector<DASamples const*> sources, const sdsl::int_vector<0>& origins, const std::vector<size_type>& record_offsets, const std::vector<size_type>& sequence_counts)
@@ -668,7 +1195,7 @@ DASamples::DASamples(const std::vector<DASamples const*> sources, const sdsl::in
 
   // Compute statistics over the records and mark the sampled nodes.
   // Note that the endmarker requires special treatment.
-  size_type record_count = 0, bwt_offsets = 0;
+  size_type record_count = 0, bwt_offsets = 0, max_length = 0;
   this->sampled_records = sdsl::bit_vector(origins.size(), 0);
   bool sample_endmarker = false;
   for(size_type origin = 0; origin < sources.size(); origin++)
@@ -683,6 +1210,7 @@ DASamples::DASamples(const std::vector<DASamples const*> sources, const sdsl::in
   {
     record_count++;
     bwt_offsets += total_sequences;
+    max_length = total_sequences;
     this->sampled_records[ENDMARKER] = 1;
   }
   for(size_type i = 1; i < origins.size(); i++)
@@ -693,6 +1221,7 @@ DASamples::DASamples(const std::vector<DASamples const*> sources, const sdsl::in
     {
       record_count++;
       bwt_offsets += range_iterators[origin].length();
+      max_length = std::max(max_length, range_iterators[origin].length());
       this->sampled_records[i] = 1;
       ++range_iterators[origin];
     }
@@ -706,46 +1235,87 @@ DASamples::DASamples(const std::vector<DASamples const*> sources, const sdsl::in
     range_iterators.push_back(SampleRangeIterator(*(sources[i])));
   }
 
-  // Build the bitvectors over BWT offsets and store the samples.
+  // Build the record ranges and store the samples.
   // The endmarker requires special treatment again.
   sdsl::sd_vector_builder range_builder(bwt_offsets, record_count);
-  sdsl::sd_vector_builder offset_builder(bwt_offsets, sample_count);
+  this->initBlocks(record_count, sample_count, max_length);
   this->array = sdsl::int_vector<0>(sample_count, 0, bit_length(total_sequences - 1));
-  size_type record_start = 0, curr = 0;
+  size_type record_start = 0, rank = 0, curr = 0;
   if(sample_endmarker)
   {
     range_builder.set(record_start);
+    this->block_starts[rank] = curr;
     for(size_type origin = 0; origin < sources.size(); origin++)
     {
       if(!(sources[origin]->isSampled(ENDMARKER))) { continue; }
       while(!(sample_iterators[origin].end()) && sample_iterators[origin].offset() < range_iterators[origin].limit())
       {
-        offset_builder.set((sample_iterators[origin]).offset() + sequence_offsets[origin]);
+        this->offsets[curr] = sample_iterators[origin].offset() + sequence_offsets[origin];
         this->array[curr] = *(sample_iterators[origin]) + sequence_offsets[origin]; curr++;
         ++sample_iterators[origin];
       }
       ++range_iterators[origin];
     }
-    record_start += total_sequences;
+    record_start += total_sequences; rank++;
   }
   for(size_type i = 1; i < origins.size(); i++)
   {
     if(!(this->isSampled(i))) { continue; }
     size_type origin = origins[i];
     range_builder.set(record_start);
+    this->block_starts[rank] = curr;
     while(!(sample_iterators[origin].end()) && sample_iterators[origin].offset() < range_iterators[origin].limit())
     {
-      offset_builder.set((sample_iterators[origin].offset() - range_iterators[origin].start()) + record_start);
+      this->offsets[curr] = sample_iterators[origin].offset() - range_iterators[origin].start();
       this->array[curr] = *(sample_iterators[origin]) + sequence_offsets[origin]; curr++;
       ++sample_iterators[origin];
     }
-    record_start += range_iterators[origin].length();
+    record_start += range_iterators[origin].length(); rank++;
     ++range_iterators[origin];
   }
+  this->block_starts[rank] = curr;
+  this->bwt_ranges = sdsl::sd_vector<>(range_builder);
+  sdsl::util::init_support(this->bwt_select, &(this->bwt_ranges));
+}
+
+DASamples::DASamples(const std::vector<std::pair<edge_type, size_type>>& samples, const RecordSizes& record_sizes)
+{
+  // Determine the statistics and mark the sampled nodes.
+  size_type record_count = 0, bwt_offsets = 0, max_length = 0, max_sample = 0;
+  this->sampled_records = sdsl::bit_vector(record_sizes.records, 0);
+  for(const std::pair<edge_type, size_type>& sample : samples)
+  {
+    if(!(this->sampled_records[sample.first.first]))
+    {
+      size_type record_size = record_sizes.size(sample.first.first);
+      record_count++; bwt_offsets += record_size;
+      max_length = std::max(max_length, record_size);
+      this->sampled_records[sample.first.first] = 1;
+    }
+    max_sample = std::max(max_sample, sample.second);
+  }
+  sdsl::util::init_support(this->record_rank, &(this->sampled_records));
+
+  // Build the record ranges and store the samples.
+  sdsl::sd_vector_builder range_builder(bwt_offsets, record_count);
+  this->initBlocks(record_count, samples.size(), max_length);
+  this->array = sdsl::int_vector<0>(samples.size(), 0, bit_length(max_sample));
+  size_type record_start = 0, rank = 0;
+  for(size_type i = 0; i < samples.size(); i++)
+  {
+    size_type record = samples[i].first.first;
+    if(i == 0 || record != samples[i - 1].first.first)
+    {
+      if(i > 0) { record_start += record_sizes.size(samples[i - 1].first.first); }
+      range_builder.set(record_start);
+      this->block_starts[rank] = i; rank++;
+    }
+    this->offsets[i] = samples[i].first.second;
+    this->array[i] = samples[i].second;
+  }
+  this->block_starts[rank] = samples.size();
   this->bwt_ranges = sdsl::sd_vector<>(range_builder);
   sdsl::util::init_support(this->bwt_select, &(this->bwt_ranges));
-  this->sampled_offsets = sdsl::sd_vector<>(offset_builder);
-  sdsl::util::init_support(this->sample_rank, &(this->sampled_offsets));
 }
 
 void
@@ -759,9 +1329,8 @@ DASamples::swap(DASamples& another)
     this->bwt_ranges.swap(another.bwt_ranges);
     sdsl::util::swap_support(this->bwt_select, another.bwt_select, &(this->bwt_ranges), &(another.bwt_ranges));
 
-    this->sampled_offsets.swap(another.sampled_offsets);
-    sdsl::util::swap_support(this->sample_rank, another.sample_rank, &(this->sampled_offsets), &(another.sampled_offsets));
-
+    this->block_starts.swap(another.block_starts);
+    this->offsets.swap(another.offsets);
     this->array.swap(another.array);
   }
 }
@@ -784,9 +1353,8 @@ DASamples::operator=(DASamples&& source)
     this->bwt_ranges = std::move(source.bwt_ranges);
     this->bwt_select = std::move(source.bwt_select);
 
-    this->sampled_offsets = std::move(source.sampled_offsets);
-    this->sample_rank = std::move(source.sample_rank);
-
+    this->block_starts = std::move(source.block_starts);
+    this->offsets = std::move(source.offsets);
     this->array = std::move(source.array);
 
     this->setVectors();
@@ -806,8 +1374,13 @@ DASamples::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::strin
   written_bytes += this->bwt_ranges.serialize(out, child, "bwt_ranges");
   written_bytes += this->bwt_select.serialize(out, child, "bwt_select");
 
-  written_bytes += this->sampled_offsets.serialize(out, child, "sampled_offsets");
-  written_bytes += this->sample_rank.serialize(out, child, "sample_rank");
+  // Regenerate the sampled offsets in the concatenation of the sampled records.
+  sdsl::sd_vector_builder offset_builder(this->bwt_ranges.size(), this->size());
+  for(SampleIterator iter(*this); !(iter.end()); ++iter) { offset_builder.set(iter.offset()); }
+  sdsl::sd_vector<> sampled_offsets(offset_builder);
+  sdsl::sd_vector<>::rank_1_type sample_rank(&sampled_offsets);
+  written_bytes += sampled_offsets.serialize(out, child, "sampled_offsets");
+  written_bytes += sample_rank.serialize(out, child, "sample_rank");
 
   written_bytes += this->array.serialize(out, child, "array");
 
@@ -824,10 +1397,14 @@ DASamples::load(std::istream& in)
   this->bwt_ranges.load(in);
   this->bwt_select.load(in, &(this->bwt_ranges));
 
-  this->sampled_offsets.load(in);
-  this->sample_rank.load(in, &(this->sampled_offsets));
+  sdsl::sd_vector<> sampled_offsets;
+  sampled_offsets.load(in);
+  sdsl::sd_vector<>::rank_1_type sample_rank;
+  sample_rank.load(in, &sampled_offsets);
 
   this->array.load(in);
+
+  this->buildBlocks(sampled_offsets);
 }
 
 void
@@ -839,9 +1416,8 @@ DASamples::copy(const DASamples& source)
   this->bwt_ranges = source.bwt_ranges;
   this->bwt_select = source.bwt_select;
 
-  this->sampled_offsets = source.sampled_offsets;
-  this->sample_rank = source.sample_rank;
-
+  this->block_starts = source.block_starts;
+  this->offsets = source.offsets;
   this->array = source.array;
 
   this->setVectors();
@@ -852,42 +1428,581 @@ DASamples::setVectors()
 {
   this->record_rank.set_vector(&(this->sampled_records));
   this->bwt_select.set_vector(&(this->bwt_ranges));
-  this->sample_rank.set_vector(&(this->sampled_offsets));
+}
+
+void
+DASamples::initBlocks(size_type record_count, size_type sample_count, size_type max_length)
+{
+  this->block_starts = sdsl::int_vector<0>(record_count + 1, 0, bit_length(std::max(sample_count, static_cast<size_type>(1))));
+  this->offsets = sdsl::int_vector<0>(sample_count, 0, bit_length(std::max(max_length, static_cast<size_type>(1))));
+}
+
+void
+DASamples::buildBlocks(const sdsl::sd_vector<>& sampled_offsets)
+{
+  size_type record_count = 0, max_length = 0;
+  for(SampleRangeIterator range_iter(*this); !(range_iter.end()); ++range_iter)
+  {
+    record_count++;
+    max_length = std::max(max_length, range_iter.length());
+  }
+  this->initBlocks(record_count, this->size(), max_length);
+
+  sdsl::sd_vector<>::select_1_type offset_select(&sampled_offsets);
+  size_type curr = 0;
+  for(SampleRangeIterator range_iter(*this); !(range_iter.end()); ++range_iter)
+  {
+    this->block_starts[range_iter.rank()] = curr;
+    while(curr < this->size())
+    {
+      size_type offset = offset_select(curr + 1);
+      if(offset >= range_iter.limit()) { break; }
+      this->offsets[curr] = offset - range_iter.start(); curr++;
+    }
+  }
+  this->block_starts[record_count] = curr;
 }
 
 size_type
-DASamples::tryLocate(size_type record, size_type offset) const
+DASamples::limit(size_type rank) const
+{
+  size_type rank_limit = this->record_rank(this->sampled_records.size());
+  return (rank + 1 < rank_limit ? this->bwt_select(rank + 2) : this->bwt_ranges.size());
+}
+
+//------------------------------------------------------------------------------
+
+RecordSizes::RecordSizes() :
+  records(0)
+{
+}
+
+RecordSizes::RecordSizes(const RecordSizes& source)
+{
+  this->copy(source);
+}
+
+RecordSizes::RecordSizes(RecordSizes&& source)
+{
+  *this = std::move(source);
+}
+
+RecordSizes::~RecordSizes()
 {
-  if(!(this->isSampled(record))) { return invalid_sequence(); }
+}
 
-  size_type record_start = this->start(record);
-  if(this->sampled_offsets[record_start + offset])
+void
+RecordSizes::swap(RecordSizes& another)
+{
+  if(this != &another)
   {
-    return this->array[this->sample_rank(record_start + offset)];
+    this->prefix_sums.swap(another.prefix_sums);
+    sdsl::util::swap_support(this->prefix_select, another.prefix_select, &(this->prefix_sums), &(another.prefix_sums));
+    std::swap(this->records, another.records);
   }
-  return invalid_sequence();
 }
 
-sample_type
-DASamples::nextSample(size_type record, size_type offset) const
+RecordSizes&
+RecordSizes::operator=(const RecordSizes& source)
 {
-  if(!(this->isSampled(record))) { return invalid_sample(); }
+  if(this != &source) { this->copy(source); }
+  return *this;
+}
 
-  size_type record_start = this->start(record);
-  size_type rank = this->sample_rank(record_start + offset);
-  if(rank < this->array.size())
+RecordSizes&
+RecordSizes::operator=(RecordSizes&& source)
+{
+  if(this != &source)
   {
-    sdsl::sd_vector<>::select_1_type sample_select(&(this->sampled_offsets));
-    return sample_type(sample_select(rank + 1) - record_start, this->array[rank]);
+    this->prefix_sums = std::move(source.prefix_sums);
+    this->prefix_select = std::move(source.prefix_select); this->prefix_select.set_vector(&(this->prefix_sums));
+    this->records = std::move(source.records);
   }
-  return invalid_sample();
+  return *this;
 }
 
 size_type
-DASamples::limit(size_type rank) const
+RecordSizes::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
 {
-  size_type rank_limit = this->record_rank(this->sampled_records.size());
-  return (rank + 1 < rank_limit ? this->bwt_select(rank + 2) : this->bwt_ranges.size());
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += this->prefix_sums.serialize(out, child, "prefix_sums");
+  written_bytes += this->prefix_select.serialize(out, child, "prefix_select");
+  written_bytes += sdsl::write_member(this->records, out, child, "records");
+
+  sdsl::structure_tree::add_size(child, written_bytes);
+  return written_bytes;
+}
+
+void
+RecordSizes::load(std::istream& in)
+{
+  this->prefix_sums.load(in);
+  this->prefix_select.load(in, &(this->prefix_sums));
+  sdsl::read_member(this->records, in);
+}
+
+void
+RecordSizes::copy(const RecordSizes& source)
+{
+  this->prefix_sums = source.prefix_sums;
+  this->prefix_select = source.prefix_select; this->prefix_select.set_vector(&(this->prefix_sums));
+  this->records = source.records;
+}
+
+//------------------------------------------------------------------------------
+
+SequenceStarts::SequenceStarts()
+{
+}
+
+SequenceStarts::SequenceStarts(const DynamicRecord& endmarker)
+{
+  std::vector<edge_type> positions; positions.reserve(endmarker.size());
+  std::vector<edge_type> ranks(endmarker.outgoing);
+  for(run_type run : endmarker.body)
+  {
+    for(size_type i = 0; i < run.second; i++)
+    {
+      positions.push_back(ranks[run.first]); ranks[run.first].second++;
+    }
+  }
+  this->build(positions);
+}
+
+SequenceStarts::SequenceStarts(const CompressedRecord& endmarker)
+{
+  std::vector<edge_type> positions;
+  if(endmarker.outdegree() > 0)
+  {
+    std::vector<edge_type> ranks(endmarker.outgoing.begin(), endmarker.outgoing.end());
+    for(CompressedRecordIterator iter(endmarker); !(iter.end()); ++iter)
+    {
+      for(size_type i = 0; i < iter->second; i++)
+      {
+        positions.push_back(ranks[iter->first]); ranks[iter->first].second++;
+      }
+    }
+  }
+  this->build(positions);
+}
+
+SequenceStarts::SequenceStarts(const std::vector<SequenceStarts const*> sources)
+{
+  std::vector<edge_type> positions;
+  for(auto source : sources)
+  {
+    for(size_type i = 0; i < source->size(); i++) { positions.push_back(source->start(i)); }
+  }
+  this->build(positions);
+}
+
+void
+SequenceStarts::build(const std::vector<edge_type>& positions)
+{
+  size_type max_node = 0, max_offset = 0;
+  for(edge_type position : positions)
+  {
+    max_node = std::max(max_node, (size_type)(position.first));
+    max_offset = std::max(max_offset, (size_type)(position.second));
+  }
+
+  this->nodes = sdsl::int_vector<0>(positions.size(), 0, bit_length(max_node));
+  this->offsets = sdsl::int_vector<0>(positions.size(), 0, bit_length(max_offset));
+  for(size_type i = 0; i < positions.size(); i++)
+  {
+    this->nodes[i] = positions[i].first;
+    this->offsets[i] = positions[i].second;
+  }
+}
+
+void
+SequenceStarts::swap(SequenceStarts& another)
+{
+  if(this != &another)
+  {
+    this->nodes.swap(another.nodes);
+    this->offsets.swap(another.offsets);
+  }
+}
+
+size_type
+SequenceStarts::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+{
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += this->nodes.serialize(out, child, "nodes");
+  written_bytes += this->offsets.serialize(out, child, "offsets");
+
+  sdsl::structure_tree::add_size(child, written_bytes);
+  return written_bytes;
+}
+
+void
+SequenceStarts::load(std::istream& in)
+{
+  this->nodes.load(in);
+  this->offsets.load(in);
+}
+
+//------------------------------------------------------------------------------
+
+UnaryChains::UnaryChains() :
+  node_offset(0)
+{
+}
+
+UnaryChains::UnaryChains(const RecordArray& bwt, size_type offset) :
+  node_offset(offset)
+{
+  auto to_comp = [offset](node_type node) -> comp_type { return (node == ENDMARKER ? node : node - offset); };
+
+  // Find the unary records and count their unary predecessors.
+  std::vector<edge_type> successors(bwt.records, invalid_edge());
+  for(comp_type comp = 1; comp < bwt.records; comp++)
+  {
+    CompressedRecord record = bwt.record(comp);
+    if(record.outdegree() == 1) { successors[comp] = record.outgoing[0]; }
+  }
+  std::vector<size_type> predecessors(bwt.records, 0);
+  for(comp_type comp = 1; comp < bwt.records; comp++)
+  {
+    if(successors[comp] == invalid_edge()) { continue; }
+    comp_type next = to_comp(successors[comp].first);
+    if(next != ENDMARKER && successors[next] != invalid_edge()) { predecessors[next]++; }
+  }
+
+  // Chains start from unary records that do not have exactly one unary predecessor.
+  std::vector<comp_type> slots;
+  std::vector<size_type> cumulative, slot_of(bwt.records, 0);
+  size_type total = 0;
+  for(comp_type comp = 1; comp < bwt.records; comp++)
+  {
+    if(successors[comp] == invalid_edge() || predecessors[comp] == 1) { continue; }
+    comp_type curr = comp;
+    while(true)
+    {
+      slots.push_back(curr); cumulative.push_back(total); slot_of[curr] = slots.size();
+      total += successors[curr].second;
+      comp_type next = to_comp(successors[curr].first);
+      if(next == ENDMARKER || successors[next] == invalid_edge() || predecessors[next] != 1) { break; }
+      curr = next;
+    }
+    slots.push_back(to_comp(successors[curr].first)); cumulative.push_back(total);
+  }
+  if(slots.empty()) { return; }
+
+  this->positions = sdsl::int_vector<0>(bwt.records, 0, bit_length(slots.size()));
+  for(comp_type comp = 0; comp < bwt.records; comp++) { this->positions[comp] = slot_of[comp]; }
+  this->nodes = sdsl::int_vector<0>(slots.size(), 0, bit_length(bwt.records + offset));
+  this->offsets = sdsl::int_vector<0>(cumulative.size(), 0, bit_length(total));
+  for(size_type slot = 0; slot < slots.size(); slot++)
+  {
+    this->nodes[slot] = (slots[slot] == ENDMARKER ? ENDMARKER : slots[slot] + node_offset);
+    this->offsets[slot] = cumulative[slot];
+  }
+}
+
+void
+UnaryChains::swap(UnaryChains& another)
+{
+  if(this != &another)
+  {
+    this->positions.swap(another.positions);
+    this->nodes.swap(another.nodes);
+    this->offsets.swap(another.offsets);
+    std::swap(this->node_offset, another.node_offset);
+  }
+}
+
+size_type
+UnaryChains::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+{
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += this->positions.serialize(out, child, "positions");
+  written_bytes += this->nodes.serialize(out, child, "nodes");
+  written_bytes += this->offsets.serialize(out, child, "offsets");
+  written_bytes += sdsl::write_member(this->node_offset, out, child, "node_offset");
+
+  sdsl::structure_tree::add_size(child, written_bytes);
+  return written_bytes;
+}
+
+void
+UnaryChains::load(std::istream& in)
+{
+  this->positions.load(in);
+  this->nodes.load(in);
+  this->offsets.load(in);
+  sdsl::read_member(this->node_offset, in);
+}
+
+//------------------------------------------------------------------------------
+
+const size_type PrefixTable::MIN_LENGTH;
+const size_type PrefixTable::MAX_LENGTH;
+const size_type PrefixTable::DEFAULT_MAX_BYTES;
+
+const std::string PrefixTable::EXTENSION = ".prefix";
+
+PrefixTable::PrefixTable() :
+  path_length(0), node_offset(0), alphabet_size(0), total_length(0)
+{
+}
+
+struct PrefixEntry
+{
+  node_type  path[PrefixTable::MAX_LENGTH];
+  range_type range;
+};
+
+/*
+  A bounded collection of prefix table entries that keeps the entries with the highest
+  support. The entries are stored in arbitrary order until the capacity is reached.
+  After that, they form a min-heap by range length.
+*/
+struct PrefixCandidates
+{
+  std::vector<PrefixEntry> entries;
+  size_type                capacity;
+  bool                     is_heap;
+
+  explicit PrefixCandidates(size_type max_entries) : capacity(max_entries), is_heap(false) {}
+
+  static bool higherSupport(const PrefixEntry& a, const PrefixEntry& b)
+  {
+    return (Range::length(a.range) > Range::length(b.range));
+  }
+
+  void insert(const PrefixEntry& entry)
+  {
+    if(this->entries.size() < this->capacity)
+    {
+      this->entries.push_back(entry);
+      if(this->entries.size() == this->capacity)
+      {
+        std::make_heap(this->entries.begin(), this->entries.end(), higherSupport);
+        this->is_heap = true;
+      }
+      return;
+    }
+    if(this->capacity == 0) { return; }
+    if(higherSupport(entry, this->entries.front()))
+    {
+      std::pop_heap(this->entries.begin(), this->entries.end(), higherSupport);
+      this->entries.back() = entry;
+      std::push_heap(this->entries.begin(), this->entries.end(), higherSupport);
+    }
+  }
+
+  // Entries with lower support cannot be inserted.
+  size_type minSupport() const
+  {
+    if(this->capacity == 0) { return invalid_offset(); }
+    return (this->is_heap ? Range::length(this->entries.front().range) + 1 : 0);
+  }
+};
+
+// Number of candidates a thread collects before merging them into the shared heap.
+const size_type PREFIX_BUFFER_SIZE = 1024;
+
+PrefixTable::PrefixTable(const RecordArray& bwt, size_type offset, size_type length, size_type max_bytes) :
+  path_length(length), node_offset(offset), alphabet_size(bwt.records + offset), total_length(0)
+{
+  if(length < MIN_LENGTH || length > MAX_LENGTH)
+  {
+    std::cerr << "PrefixTable::PrefixTable(): Invalid path length: " << length << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  auto to_comp = [offset](node_type node) -> comp_type { return (node == ENDMARKER ? node : node - offset); };
+  auto to_node = [offset](comp_type comp) -> node_type { return (comp == ENDMARKER ? comp : comp + offset); };
+
+  // The range width is not known before the records have been decoded. Hence we bound
+  // the number of candidates during collection using the minimum range width.
+  size_type node_width = bit_length(std::max(this->alphabet_size, static_cast<size_type>(1)));
+  size_type max_candidates = (max_bytes * 8) / (length * node_width + 2);
+
+  // Extend the full range of each record to all successors, and again for paths of length 3.
+  // The threads buffer the candidates and merge them into a shared heap. Candidates with
+  // less support than the current minimum in a full heap are discarded immediately.
+  PrefixCandidates candidates(max_candidates);
+  std::atomic<size_type> min_support(candidates.minSupport());
+  size_type max_size = 0;
+  #pragma omp parallel
+  {
+    std::vector<PrefixEntry> buffer;
+    buffer.reserve(PREFIX_BUFFER_SIZE);
+    auto flush = [&]()
+    {
+      #pragma omp critical
+      {
+        for(const PrefixEntry& entry : buffer) { candidates.insert(entry); }
+        min_support = candidates.minSupport();
+      }
+      buffer.clear();
+    };
+    auto add = [&](const PrefixEntry& entry)
+    {
+      if(Range::length(entry.range) < min_support.load(std::memory_order_relaxed)) { return; }
+      buffer.push_back(entry);
+      if(buffer.size() >= PREFIX_BUFFER_SIZE) { flush(); }
+    };
+
+    size_type thread_length = 0, thread_max = 0;
+    #pragma omp for schedule(dynamic, 1)
+    for(comp_type comp = 0; comp < bwt.records; comp++)
+    {
+      CompressedRecord record = bwt.record(comp);
+      size_type record_size = record.size();
+      thread_length += record_size;
+      thread_max = std::max(thread_max, record_size);
+      if(record_size == 0) { continue; }
+      std::vector<range_type> first = record.LF(range_type(0, record_size - 1));
+      for(rank_type outrank = 0; outrank < record.outdegree(); outrank++)
+      {
+        if(Range::empty(first[outrank])) { continue; }
+        PrefixEntry entry;
+        entry.path[0] = to_node(comp); entry.path[1] = record.successor(outrank);
+        if(length == 2)
+        {
+          entry.range = first[outrank];
+          add(entry);
+          continue;
+        }
+        CompressedRecord next = bwt.record(to_comp(entry.path[1]));
+        std::vector<range_type> second = next.LF(first[outrank]);
+        for(rank_type next_rank = 0; next_rank < next.outdegree(); next_rank++)
+        {
+          if(Range::empty(second[next_rank])) { continue; }
+          entry.path[2] = next.successor(next_rank);
+          entry.range = second[next_rank];
+          add(entry);
+        }
+      }
+    }
+    flush();
+    #pragma omp critical
+    {
+      this->total_length += thread_length;
+      max_size = std::max(max_size, thread_max);
+    }
+  }
+  std::vector<PrefixEntry> entries;
+  entries.swap(candidates.entries);
+
+  // Apply the exact memory cap by keeping the paths with the highest support.
+  size_type range_width = bit_length(std::max(max_size, static_cast<size_type>(1)));
+  size_type entry_bits = length * node_width + 2 * range_width;
+  size_type max_entries = (max_bytes * 8) / entry_bits;
+  if(entries.size() > max_entries)
+  {
+    std::nth_element(entries.begin(), entries.begin() + max_entries, entries.end(), PrefixCandidates::higherSupport);
+    entries.resize(max_entries);
+  }
+
+  auto path_order = [length](const PrefixEntry& a, const PrefixEntry& b) -> bool
+  {
+    return std::lexicographical_compare(a.path, a.path + length, b.path, b.path + length);
+  };
+  parallelQuickSort(entries.begin(), entries.end(), path_order);
+
+  this->paths = sdsl::int_vector<0>(entries.size() * length, 0, node_width);
+  this->ranges = sdsl::int_vector<0>(entries.size() * 2, 0, range_width);
+  for(size_type i = 0; i < entries.size(); i++)
+  {
+    for(size_type j = 0; j < length; j++) { this->paths[i * length + j] = entries[i].path[j]; }
+    this->ranges[2 * i] = entries[i].range.first;
+    this->ranges[2 * i + 1] = entries[i].range.second;
+  }
+}
+
+void
+PrefixTable::swap(PrefixTable& another)
+{
+  if(this != &another)
+  {
+    std::swap(this->path_length, another.path_length);
+    this->paths.swap(another.paths);
+    this->ranges.swap(another.ranges);
+    std::swap(this->node_offset, another.node_offset);
+    std::swap(this->alphabet_size, another.alphabet_size);
+    std::swap(this->total_length, another.total_length);
+  }
+}
+
+size_type
+PrefixTable::serialize(std::ostream& out, sdsl::structure_tree_node* v, std::string name) const
+{
+  sdsl::structure_tree_node* child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+  size_type written_bytes = 0;
+
+  written_bytes += sdsl::write_member(this->path_length, out, child, "path_length");
+  written_bytes += this->paths.serialize(out, child, "paths");
+  written_bytes += this->ranges.serialize(out, child, "ranges");
+  written_bytes += sdsl::write_member(this->node_offset, out, child, "node_offset");
+  written_bytes += sdsl::write_member(this->alphabet_size, out, child, "alphabet_size");
+  written_bytes += sdsl::write_member(this->total_length, out, child, "total_length");
+
+  sdsl::structure_tree::add_size(child, written_bytes);
+  return written_bytes;
+}
+
+void
+PrefixTable::load(std::istream& in)
+{
+  sdsl::read_member(this->path_length, in);
+  this->paths.load(in);
+  this->ranges.load(in);
+  sdsl::read_member(this->node_offset, in);
+  sdsl::read_member(this->alphabet_size, in);
+  sdsl::read_member(this->total_length, in);
+}
+
+int
+PrefixTable::compare(size_type index, const node_type* path) const
+{
+  for(size_type j = 0; j < this->path_length; j++)
+  {
+    node_type node = this->paths[index * this->path_length + j];
+    if(node != path[j]) { return (node < path[j] ? -1 : 1); }
+  }
+  return 0;
+}
+
+range_type
+PrefixTable::find(const node_type* path) const
+{
+  // Invariant: the path is in [low, high).
+  size_type low = 0, high = this->size();
+  while(low < high)
+  {
+    size_type mid = low + (high - low) / 2;
+    int result = this->compare(mid, path);
+    if(result == 0) { return range_type(this->ranges[2 * mid], this->ranges[2 * mid + 1]); }
+    if(result < 0) { low = mid + 1; }
+    else { high = mid; }
+  }
+  return Range::empty_range();
+}
+
+range_type
+PrefixTable::find(node_type first, node_type second) const
+{
+  if(this->length() != 2) { return Range::empty_range(); }
+  node_type path[2] = { first, second };
+  return this->find(path);
+}
+
+range_type
+PrefixTable::find(node_type first, node_type second, node_type third) const
+{
+  if(this->length() != 3) { return Range::empty_range(); }
+  node_type path[3] = { first, second, third };
+  return this->find(path);
 }
 
 //------------------------------------------------------------------------------